@@ -0,0 +1,796 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Topology.h"
+#include "Parallel.h"
+#include "SignedDistanceField.h"
+
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#define BVH_LEAF_SIZE 4
+#define BVH_FULL_CONE 3.14159265f
+#define BVH_CONTOUR_EDGES 64   // longest patch boundary the contour test walks; longer ones are never culled
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+inline bool Overlap(const AABB& a, const AABB& b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x
+        && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// bound on the face normals of a subtree: every normal is within angle of axis
+struct NormalCone {
+    glm::vec3 axis;
+    float angle;
+};
+
+struct BVHNode {
+    AABB box;
+    NormalCone cone;
+    int left;       // child indices, -1 for a leaf
+    int right;
+    int start;      // first slot in triangleOrder
+    int count;      // number of triangles in the subtree
+    bool connected; // the triangles of the subtree form one edge connected patch
+};
+
+struct TrianglePair {
+    int first;
+    int second;
+};
+
+struct BVHStats {
+    float buildMs;
+    float refitMs;
+    float traverseMs;
+    int rebuilds;
+    float quality;      // internal node surface area relative to the last build, rebuilt above rebuildThreshold
+    float overlap;      // mean fraction of a node's volume shared by both of its children
+    int pairs;
+    int culled;         // self tests skipped by the normal cones
+};
+
+// Linear BVH over the triangles of an index buffer. Triangles are ordered by the Morton code of their
+// centroid and split top down at the highest differing bit. Each step the boxes are refitted bottom up,
+// one tree level at a time with the nodes of a level processed in parallel; once refitting has inflated
+// the tree too much relative to its last build, it is rebuilt from the current positions.
+//
+// Every node also keeps a cone bounding the normals of its triangles (Volino and Magnenat-Thalmann,
+// "Efficient self-collision detection on smoothly discretized surface animations using geometrical shape
+// regularity"). A connected patch whose normals all lie within 90 degrees of one direction projects onto
+// the plane across that direction without flipping, but it can still wind over itself like a spiral ramp,
+// so the test is only skipped when the projected boundary of the patch does not cross itself either. The
+// same holds for two subtrees that together form such a patch. Contacts closer than thickness inside a
+// patch that passes are still skipped, so the culling is approximate and off by default.
+class TriangleBVH
+{
+public:
+    vector<BVHNode> nodes;
+    vector<int> triangleOrder;
+    vector<AABB> triangleBoxes;
+    float thickness = 0;
+    float rebuildThreshold = 1.5f;
+    bool normalConeCulling = false;
+    // the exact bound is 90 degrees, but two layers of a tight fold have normals that are just under 180
+    // degrees apart, so the limit keeps a margin below it and such folds are still tested
+    float coneAngleLimit = 1.4f;
+    BVHStats stats = {};
+
+    // edge adjacency of the triangles, used for the connectivity of the nodes; call before Build
+    void SetNeighbours(int triangleCount, const vector<Neighbour>& neighbours)
+    {
+        neighbourStart.assign(triangleCount + 1, 0);
+        for (int i = 0; i < neighbours.size(); i++) { neighbourStart[neighbours[i].firstTriangle + 1]++; neighbourStart[neighbours[i].secondTriangle + 1]++; }
+        for (int t = 0; t < triangleCount; t++)
+            neighbourStart[t + 1] += neighbourStart[t];
+
+        neighbourList.resize(neighbourStart[triangleCount]);
+        vector<int> fill(neighbourStart.begin(), neighbourStart.end() - 1);
+        for (int i = 0; i < neighbours.size(); i++)
+        {
+            neighbourList[fill[neighbours[i].firstTriangle]++] = neighbours[i].secondTriangle;
+            neighbourList[fill[neighbours[i].secondTriangle]++] = neighbours[i].firstTriangle;
+        }
+    }
+
+    void Build(const vector<Vertex>& vertices, const vector<unsigned int>& indices)
+    {
+        auto t0 = chrono::steady_clock::now();
+        this->indices = indices;
+        int triangleCount = indices.size() / 3;
+        updateTriangleBoxes(vertices);
+
+        // Morton codes of the centroids inside the mesh bounds
+        AABB bounds = { glm::vec3(INFINITY), glm::vec3(-INFINITY) };
+        for (int t = 0; t < triangleCount; t++)
+        {
+            bounds.min = glm::min(bounds.min, triangleBoxes[t].min);
+            bounds.max = glm::max(bounds.max, triangleBoxes[t].max);
+        }
+        glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+        vector<uint64_t> keys(triangleCount);
+        ParallelFor(0, triangleCount, [&](int t)
+            {
+                glm::vec3 c = ((triangleBoxes[t].min + triangleBoxes[t].max) * 0.5f - bounds.min) / extent;
+                keys[t] = ((uint64_t)morton3D(c) << 32) | (uint32_t)t;
+            }, 4096);
+        sort(keys.begin(), keys.end());
+
+        triangleOrder.resize(triangleCount);
+        triangleSlot.resize(triangleCount);
+        codes.resize(triangleCount);
+        for (int i = 0; i < triangleCount; i++)
+        {
+            triangleOrder[i] = (int)(keys[i] & 0xffffffffu);
+            triangleSlot[triangleOrder[i]] = i;
+            codes[i] = (uint32_t)(keys[i] >> 32);
+        }
+
+        nodes.clear();
+        levels.clear();
+        if (triangleCount > 0)
+            buildNode(0, triangleCount - 1, 0);
+        refitLevels();
+        buildArea = internalArea();
+
+        stats.buildMs = chrono::duration<float, milli>(chrono::steady_clock::now() - t0).count();
+        stats.quality = 1;
+        overgrown = false;
+    }
+
+    // the given triangles keep their place in the tree but were renumbered (tearing); their nodes no longer
+    // count as connected patches, which only costs some culling until the next rebuild
+    void UpdateTriangles(const vector<unsigned int>& meshIndices, const vector<int>& triangles)
+    {
+        for (int i = 0; i < triangles.size(); i++)
+        {
+            int t = triangles[i];
+            for (int k = 0; k < 3; k++)
+                indices[3 * t + k] = meshIndices[3 * t + k];
+            int slot = triangleSlot[t];
+            for (int n = 0; n >= 0; )
+            {
+                BVHNode& node = nodes[n];
+                node.connected = false;
+                if (node.left < 0) break;
+                const BVHNode& left = nodes[node.left];
+                n = slot < left.start + left.count ? node.left : node.right;
+            }
+        }
+    }
+
+    // the triangles were added, removed and renumbered by a local edit (remeshing); origin[t] is the triangle
+    // t was before it, or the one t was split off. The tree keeps its shape: every triangle goes into the leaf
+    // of its origin and the slots are laid out again, in linear time. Leaves that changed no longer count as
+    // connected patches, and the next Refit rebuilds once one of them has grown well past the leaf size.
+    void UpdateTopology(const vector<unsigned int>& meshIndices, const vector<int>& origin)
+    {
+        int triangleCount = meshIndices.size() / 3;
+        vector<int> leafOfSlot(triangleOrder.size());
+        for (int n = 0; n < nodes.size(); n++)
+            if (nodes[n].left < 0)
+                for (int i = nodes[n].start; i < nodes[n].start + nodes[n].count; i++)
+                    leafOfSlot[i] = n;
+
+        vector<int> leaf(triangleCount);
+        vector<int> count(nodes.size(), 0);
+        vector<char> changed(nodes.size(), 0);
+        for (int t = 0; t < triangleCount && !nodes.empty(); t++)
+        {
+            int o = origin[t];
+            leaf[t] = leafOfSlot[triangleSlot[o]];
+            count[leaf[t]]++;
+            for (int k = 0; k < 3; k++)
+                if (meshIndices[3 * t + k] != indices[3 * o + k]) changed[leaf[t]] = 1;
+        }
+
+        // leaves are numbered left to right, so their new slot ranges follow in node order
+        vector<int> fill(nodes.size(), 0);
+        int slot = 0, largest = 0;
+        for (int n = 0; n < nodes.size(); n++)
+        {
+            BVHNode& node = nodes[n];
+            if (node.left >= 0) continue;
+            if (count[n] != node.count) changed[n] = 1;
+            node.start = fill[n] = slot;
+            node.count = count[n];
+            slot += count[n];
+            largest = max(largest, count[n]);
+        }
+        triangleOrder.resize(triangleCount);
+        triangleSlot.resize(triangleCount);
+        for (int t = 0; t < triangleCount && !nodes.empty(); t++)
+        {
+            int s = fill[leaf[t]]++;
+            triangleOrder[s] = t;
+            triangleSlot[t] = s;
+        }
+        for (int d = (int)levels.size() - 1; d >= 0; d--)
+            for (int i = 0; i < levels[d].size(); i++)
+            {
+                int n = levels[d][i];
+                BVHNode& node = nodes[n];
+                if (node.left >= 0)
+                {
+                    node.start = nodes[node.left].start;
+                    node.count = nodes[node.left].count + nodes[node.right].count;
+                    changed[n] = changed[node.left] || changed[node.right];
+                }
+                if (changed[n]) node.connected = false;
+            }
+        indices = meshIndices;
+        overgrown = overgrown || nodes.empty() || largest > 4 * BVH_LEAF_SIZE;
+    }
+
+    // refits every box from the current positions and rebuilds when the tree quality has degraded.
+    // swept boxes cover each triangle's motion from oldPos to Position, for continuous collision.
+    void Refit(const vector<Vertex>& vertices, bool swept = false)
+    {
+        if (indices.empty()) return;
+        auto t0 = chrono::steady_clock::now();
+        updateTriangleBoxes(vertices, swept);
+        refitLevels();
+        stats.quality = buildArea > 0 ? internalArea() / buildArea : 1;
+        stats.refitMs = chrono::duration<float, milli>(chrono::steady_clock::now() - t0).count();
+
+        if (stats.quality > rebuildThreshold || overgrown)
+        {
+            float refitMs = stats.refitMs;
+            vector<unsigned int> triangles;
+            triangles.swap(indices);
+            Build(vertices, triangles);
+            if (swept)
+            {
+                updateTriangleBoxes(vertices, true);
+                refitLevels();
+            }
+            stats.refitMs = refitMs;
+            stats.rebuilds++;
+        }
+    }
+
+    // candidate pairs of non adjacent triangles whose (thickness padded) boxes overlap
+    void SelfCollide(vector<TrianglePair>& pairs)
+    {
+        auto t0 = chrono::steady_clock::now();
+        pairs.clear();
+        if (nodes.empty()) return;
+
+        // expand the top of the traversal into independent tasks, then run them in parallel
+        vector<TrianglePair> tasks;
+        TrianglePair root = { 0, 0 };
+        tasks.push_back(root);
+        int targetTasks = 8 * ThreadPool::Get().Size();
+        for (int i = 0; i < tasks.size() && tasks.size() < targetTasks; )
+        {
+            TrianglePair task = tasks[i];
+            const BVHNode& a = nodes[task.first];
+            const BVHNode& b = nodes[task.second];
+            if (task.first == task.second && cannotFold(a))
+            {
+                tasks[i] = tasks.back();
+                tasks.pop_back();
+                continue;
+            }
+            if (a.left < 0 && b.left < 0) { i++; continue; }
+
+            tasks[i] = tasks.back();
+            tasks.pop_back();
+            if (task.first == task.second)
+            {
+                TrianglePair l = { a.left, a.left }, r = { a.right, a.right }, lr = { a.left, a.right };
+                tasks.push_back(l);
+                tasks.push_back(r);
+                if (Overlap(nodes[a.left].box, nodes[a.right].box)) tasks.push_back(lr);
+            }
+            else
+            {
+                int split = descendFirst(a, b) ? task.first : task.second;
+                int other = split == task.first ? task.second : task.first;
+                TrianglePair p0 = { nodes[split].left, other }, p1 = { nodes[split].right, other };
+                if (Overlap(nodes[p0.first].box, nodes[other].box)) tasks.push_back(p0);
+                if (Overlap(nodes[p1.first].box, nodes[other].box)) tasks.push_back(p1);
+            }
+        }
+
+        vector<vector<TrianglePair>> found(tasks.size());
+        ParallelFor(0, tasks.size(), [&](int i)
+            {
+                if (tasks[i].first == tasks[i].second) selfTraverse(tasks[i].first, found[i]);
+                else pairTraverse(tasks[i].first, tasks[i].second, found[i]);
+            }, 1);
+        for (int i = 0; i < found.size(); i++)
+            pairs.insert(pairs.end(), found[i].begin(), found[i].end());
+
+        stats.pairs = pairs.size();
+        stats.culled = culled.load(memory_order_relaxed);
+        culled.store(0, memory_order_relaxed);
+        stats.traverseMs = chrono::duration<float, milli>(chrono::steady_clock::now() - t0).count();
+    }
+
+    // nearest triangle to p and the closest point on it, or -1 for an empty tree. Depth first, nearer child
+    // first, skipping nodes whose box is farther away than the best triangle so far.
+    int Closest(const vector<Vertex>& vertices, const glm::vec3& p, glm::vec3& closest) const
+    {
+        int best = -1;
+        float bestDistance = INFINITY;
+        if (nodes.empty()) return best;
+        int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BVHNode& node = nodes[stack[--top]];
+            if (boxDistance(node.box, p) >= bestDistance) continue;
+            if (node.left < 0)
+            {
+                for (int i = node.start; i < node.start + node.count; i++)
+                {
+                    int t = triangleOrder[i];
+                    int region;
+                    glm::vec3 q = ClosestPointOnTriangle(p, vertices[indices[3 * t]].Position, vertices[indices[3 * t + 1]].Position, vertices[indices[3 * t + 2]].Position, region);
+                    float d = glm::dot(p - q, p - q);
+                    if (d < bestDistance)
+                    {
+                        bestDistance = d;
+                        best = t;
+                        closest = q;
+                    }
+                }
+                continue;
+            }
+            int near = node.left, far = node.right;
+            if (boxDistance(nodes[far].box, p) < boxDistance(nodes[near].box, p)) swap(near, far);
+            stack[top++] = far;
+            stack[top++] = near;
+        }
+        return best;
+    }
+
+private:
+    vector<unsigned int> indices;
+    vector<uint32_t> codes;
+    vector<vector<int>> levels;
+    vector<int> triangleSlot;       // inverse of triangleOrder
+    vector<int> neighbourStart;     // CSR triangle adjacency from SetNeighbours
+    vector<int> neighbourList;
+    vector<NormalCone> triangleCones;
+    vector<glm::vec3> positions;    // vertex positions of the last refit, for the contour test
+    vector<glm::vec3> oldPositions; // and the start of the motion of a swept refit, empty otherwise
+    mutable atomic<int> culled{ 0 };
+    float buildArea = 0;
+    bool overgrown = false;         // UpdateTopology left a leaf too large, or there was no tree to update
+
+    // squared distance from p to a box, 0 inside
+    static float boxDistance(const AABB& box, const glm::vec3& p)
+    {
+        glm::vec3 d = glm::max(glm::max(box.min - p, p - box.max), glm::vec3(0));
+        return glm::dot(d, d);
+    }
+
+    static uint32_t expandBits(uint32_t v)
+    {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    // 30 bit Morton code of a point in the unit cube
+    static uint32_t morton3D(const glm::vec3& p)
+    {
+        glm::vec3 q = glm::clamp(p * 1024.0f, 0.0f, 1023.0f);
+        return (expandBits((uint32_t)q.x) << 2) | (expandBits((uint32_t)q.y) << 1) | expandBits((uint32_t)q.z);
+    }
+
+    static int highestBit(uint32_t v)
+    {
+        int bit = -1;
+        while (v) { v >>= 1; bit++; }
+        return bit;
+    }
+
+    static float area(const AABB& b)
+    {
+        glm::vec3 d = glm::max(b.max - b.min, glm::vec3(0));
+        return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    // smallest cone containing both cones
+    static NormalCone merge(const NormalCone& a, const NormalCone& b)
+    {
+        if (a.angle >= BVH_FULL_CONE || b.angle >= BVH_FULL_CONE)
+        {
+            NormalCone full = { a.axis, BVH_FULL_CONE };
+            return full;
+        }
+        float between = acosf(glm::clamp(glm::dot(a.axis, b.axis), -1.0f, 1.0f));
+        if (between + b.angle <= a.angle) return a;
+        if (between + a.angle <= b.angle) return b;
+
+        NormalCone cone;
+        cone.angle = 0.5f * (between + a.angle + b.angle);
+        if (cone.angle >= BVH_FULL_CONE || between < 1e-6f)
+        {
+            cone.axis = a.axis;
+            cone.angle = min(cone.angle, BVH_FULL_CONE);
+            return cone;
+        }
+        // rotate a.axis towards b.axis by the growth of the angle
+        float turn = cone.angle - a.angle;
+        cone.axis = (sinf(between - turn) * a.axis + sinf(turn) * b.axis) / sinf(between);
+        return cone;
+    }
+
+    // a connected patch with every normal inside a half space and a boundary whose projection along the
+    // cone axis does not cross itself has no self intersection
+    bool cannotFold(const BVHNode& node) const
+    {
+        if (!normalConeCulling || !node.connected || node.cone.angle >= coneAngleLimit) return false;
+        if (!contourSimple(node.start, node.start + node.count - 1, 0, -1, node.cone.axis)) return false;
+        culled.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // the same for the union of two subtrees; the cheap cone test runs before the adjacency walk
+    bool cannotFold(const BVHNode& a, const BVHNode& b) const
+    {
+        if (!normalConeCulling || !a.connected || !b.connected) return false;
+        NormalCone cone = merge(a.cone, b.cone);
+        if (cone.angle >= coneAngleLimit) return false;
+        if (!touching(a.start, a.start + a.count - 1, b.start, b.start + b.count - 1)) return false;
+        if (!contourSimple(a.start, a.start + a.count - 1, b.start, b.start + b.count - 1, cone.axis)) return false;
+        culled.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // true when the boundary of the patch in slots [aFirst, aLast] and [bFirst, bLast], projected onto the
+    // plane across axis, has no two crossing edges (in both end states of a swept refit). Edges that touch
+    // or overlap count as crossing, and so does a boundary longer than BVH_CONTOUR_EDGES.
+    bool contourSimple(int aFirst, int aLast, int bFirst, int bLast, const glm::vec3& axis) const
+    {
+        int count = (aLast - aFirst + 1) + max(bLast - bFirst + 1, 0);
+        if (count > BVH_CONTOUR_EDGES * BVH_CONTOUR_EDGES / 8 || positions.empty()) return false;
+        auto inside = [&](int slot) { return (slot >= aFirst && slot <= aLast) || (slot >= bFirst && slot <= bLast); };
+
+        // an edge is on the boundary unless a triangle of the patch shares it
+        unsigned int edges[2 * BVH_CONTOUR_EDGES];
+        int edgeCount = 0;
+        for (int range = 0; range < 2; range++)
+        {
+            int first = range == 0 ? aFirst : bFirst, last = range == 0 ? aLast : bLast;
+            for (int i = first; i <= last; i++)
+            {
+                int t = triangleOrder[i];
+                for (int e = 0; e < 3; e++)
+                {
+                    unsigned int p = indices[3 * t + e], q = indices[3 * t + (e + 1) % 3];
+                    bool shared = false;
+                    for (int k = neighbourStart[t]; k < neighbourStart[t + 1] && !shared; k++)
+                    {
+                        int n = neighbourList[k];
+                        shared = inside(triangleSlot[n]) && hasVertex(n, p) && hasVertex(n, q);
+                    }
+                    if (shared) continue;
+                    if (edgeCount == BVH_CONTOUR_EDGES) return false;
+                    edges[2 * edgeCount] = p;
+                    edges[2 * edgeCount + 1] = q;
+                    edgeCount++;
+                }
+            }
+        }
+
+        glm::vec3 u = glm::normalize(glm::cross(axis, fabsf(axis.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0)));
+        glm::vec3 v = glm::cross(axis, u);
+        glm::vec2 projected[2 * BVH_CONTOUR_EDGES];
+        for (int state = 0; state < (oldPositions.empty() ? 1 : 2); state++)
+        {
+            const vector<glm::vec3>& at = state == 0 ? positions : oldPositions;
+            for (int i = 0; i < 2 * edgeCount; i++)
+                projected[i] = glm::vec2(glm::dot(at[edges[i]], u), glm::dot(at[edges[i]], v));
+            for (int i = 0; i < edgeCount; i++)
+                for (int j = i + 1; j < edgeCount; j++)
+                {
+                    if (edges[2 * i] == edges[2 * j] || edges[2 * i] == edges[2 * j + 1]
+                        || edges[2 * i + 1] == edges[2 * j] || edges[2 * i + 1] == edges[2 * j + 1]) continue;
+                    if (segmentsCross(projected[2 * i], projected[2 * i + 1], projected[2 * j], projected[2 * j + 1])) return false;
+                }
+        }
+        return true;
+    }
+
+    bool hasVertex(int t, unsigned int v) const
+    {
+        return indices[3 * t] == v || indices[3 * t + 1] == v || indices[3 * t + 2] == v;
+    }
+
+    static float orient(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    // closed segments, so touching and collinear overlapping segments also cross
+    static bool segmentsCross(const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& q0, const glm::vec2& q1)
+    {
+        float d0 = orient(q0, q1, p0), d1 = orient(q0, q1, p1);
+        float d2 = orient(p0, p1, q0), d3 = orient(p0, p1, q1);
+        return (d0 <= 0 || d1 <= 0) && (d0 >= 0 || d1 >= 0) && (d2 <= 0 || d3 <= 0) && (d2 >= 0 || d3 >= 0);
+    }
+
+    static float volume(const AABB& b)
+    {
+        glm::vec3 d = glm::max(b.max - b.min, glm::vec3(0));
+        return d.x * d.y * d.z;
+    }
+
+    int buildNode(int first, int last, int depth)
+    {
+        int index = nodes.size();
+        BVHNode node = { {}, {}, -1, -1, first, last - first + 1, true };
+        nodes.push_back(node);
+        if (levels.size() <= depth) levels.resize(depth + 1);
+        levels[depth].push_back(index);
+        if (last - first + 1 <= BVH_LEAF_SIZE)
+        {
+            nodes[index].connected = leafConnected(first, last);
+            return index;
+        }
+
+        // split where the highest differing Morton bit flips, or in the middle for equal codes
+        int split = (first + last) / 2;
+        uint32_t diff = codes[first] ^ codes[last];
+        if (diff != 0)
+        {
+            uint32_t bit = 1u << highestBit(diff);
+            int lo = first, hi = last;
+            while (lo + 1 < hi)
+            {
+                int mid = (lo + hi) / 2;
+                if ((codes[mid] & bit) == (codes[first] & bit)) lo = mid;
+                else hi = mid;
+            }
+            split = lo;
+        }
+
+        int left = buildNode(first, split, depth + 1);
+        int right = buildNode(split + 1, last, depth + 1);
+        nodes[index].left = left;
+        nodes[index].right = right;
+        nodes[index].connected = nodes[left].connected && nodes[right].connected && touching(first, split, split + 1, last);
+        return index;
+    }
+
+    // flood fill over the few triangles of a leaf
+    bool leafConnected(int first, int last) const
+    {
+        if (first == last) return true;
+        if (neighbourStart.size() != triangleSlot.size() + 1) return false;
+        unsigned int reached = 1, size = last - first + 1;
+        for (bool grown = true; grown; )
+        {
+            grown = false;
+            for (int i = 0; i < size; i++)
+            {
+                if (!(reached & (1u << i))) continue;
+                int t = triangleOrder[first + i];
+                for (int k = neighbourStart[t]; k < neighbourStart[t + 1]; k++)
+                {
+                    int slot = triangleSlot[neighbourList[k]] - first;
+                    if (slot < 0 || slot >= size || (reached & (1u << slot))) continue;
+                    reached |= 1u << slot;
+                    grown = true;
+                }
+            }
+        }
+        return reached == (1u << size) - 1;
+    }
+
+    // true when a triangle in slots [aFirst, aLast] shares an edge with one in [bFirst, bLast]
+    bool touching(int aFirst, int aLast, int bFirst, int bLast) const
+    {
+        if (neighbourStart.size() != triangleSlot.size() + 1) return false;
+        // walk the smaller side
+        bool aSmaller = aLast - aFirst < bLast - bFirst;
+        int from = aSmaller ? aFirst : bFirst, to = aSmaller ? aLast : bLast;
+        int otherFirst = aSmaller ? bFirst : aFirst, otherLast = aSmaller ? bLast : aLast;
+        for (int i = from; i <= to; i++)
+        {
+            int t = triangleOrder[i];
+            for (int k = neighbourStart[t]; k < neighbourStart[t + 1]; k++)
+            {
+                int slot = triangleSlot[neighbourList[k]];
+                if (slot >= otherFirst && slot <= otherLast) return true;
+            }
+        }
+        return false;
+    }
+
+    void updateTriangleBoxes(const vector<Vertex>& vertices, bool swept = false)
+    {
+        const vector<unsigned int>& idx = indices;
+        triangleBoxes.resize(idx.size() / 3);
+        triangleCones.resize(idx.size() / 3);
+        positions.resize(vertices.size());
+        oldPositions.resize(swept ? vertices.size() : 0);
+        ParallelFor(0, vertices.size(), [&](int i)
+            {
+                positions[i] = vertices[i].Position;
+                if (swept) oldPositions[i] = vertices[i].oldPos;
+            }, 4096);
+        glm::vec3 pad(thickness);
+        ParallelFor(0, triangleBoxes.size(), [&](int t)
+            {
+                const glm::vec3& a = vertices[idx[3 * t]].Position;
+                const glm::vec3& b = vertices[idx[3 * t + 1]].Position;
+                const glm::vec3& c = vertices[idx[3 * t + 2]].Position;
+                triangleBoxes[t].min = glm::min(a, glm::min(b, c)) - pad;
+                triangleBoxes[t].max = glm::max(a, glm::max(b, c)) + pad;
+                triangleCones[t] = faceCone(a, b, c);
+                if (swept)
+                {
+                    const glm::vec3& a0 = vertices[idx[3 * t]].oldPos;
+                    const glm::vec3& b0 = vertices[idx[3 * t + 1]].oldPos;
+                    const glm::vec3& c0 = vertices[idx[3 * t + 2]].oldPos;
+                    triangleBoxes[t].min = glm::min(triangleBoxes[t].min, glm::min(a0, glm::min(b0, c0)) - pad);
+                    triangleBoxes[t].max = glm::max(triangleBoxes[t].max, glm::max(a0, glm::max(b0, c0)) + pad);
+                    // the normal sweeps between its two end states, assuming it does not flip in between
+                    triangleCones[t] = merge(triangleCones[t], faceCone(a0, b0, c0));
+                }
+            }, 4096);
+    }
+
+    static NormalCone faceCone(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float len = glm::length(n);
+        NormalCone cone = { glm::vec3(0, 1, 0), BVH_FULL_CONE };
+        if (len > 1e-12f)
+        {
+            cone.axis = n / len;
+            cone.angle = 0;
+        }
+        return cone;
+    }
+
+    void refitLevels()
+    {
+        float overlapSum = 0;
+        int internalCount = 0;
+        for (int d = (int)levels.size() - 1; d >= 0; d--)
+        {
+            const vector<int>& level = levels[d];
+            ParallelFor(0, level.size(), [&](int i)
+                {
+                    BVHNode& node = nodes[level[i]];
+                    if (node.left < 0 && node.count == 0)
+                    {
+                        // emptied by UpdateTopology; the box overlaps nothing and the cone is ignored
+                        node.box.min = glm::vec3(INFINITY);
+                        node.box.max = glm::vec3(-INFINITY);
+                        node.cone.axis = glm::vec3(0, 1, 0);
+                        node.cone.angle = 0;
+                    }
+                    else if (node.left < 0)
+                    {
+                        AABB box = triangleBoxes[triangleOrder[node.start]];
+                        NormalCone cone = triangleCones[triangleOrder[node.start]];
+                        for (int k = 1; k < node.count; k++)
+                        {
+                            const AABB& t = triangleBoxes[triangleOrder[node.start + k]];
+                            box.min = glm::min(box.min, t.min);
+                            box.max = glm::max(box.max, t.max);
+                            cone = merge(cone, triangleCones[triangleOrder[node.start + k]]);
+                        }
+                        node.box = box;
+                        node.cone = cone;
+                    }
+                    else
+                    {
+                        node.box.min = glm::min(nodes[node.left].box.min, nodes[node.right].box.min);
+                        node.box.max = glm::max(nodes[node.left].box.max, nodes[node.right].box.max);
+                        if (nodes[node.left].count == 0) node.cone = nodes[node.right].cone;
+                        else if (nodes[node.right].count == 0) node.cone = nodes[node.left].cone;
+                        else node.cone = merge(nodes[node.left].cone, nodes[node.right].cone);
+                    }
+                }, 256);
+
+            for (int i = 0; i < level.size(); i++)
+            {
+                const BVHNode& node = nodes[level[i]];
+                if (node.left < 0) continue;
+                AABB shared = { glm::max(nodes[node.left].box.min, nodes[node.right].box.min), glm::min(nodes[node.left].box.max, nodes[node.right].box.max) };
+                float v = volume(node.box);
+                overlapSum += v > 0 ? volume(shared) / v : 0;
+                internalCount++;
+            }
+        }
+        stats.overlap = internalCount > 0 ? overlapSum / internalCount : 0;
+    }
+
+    float internalArea() const
+    {
+        float sum = 0;
+        for (int i = 0; i < nodes.size(); i++)
+            if (nodes[i].left >= 0) sum += area(nodes[i].box);
+        return sum;
+    }
+
+    bool descendFirst(const BVHNode& a, const BVHNode& b) const
+    {
+        if (b.left < 0) return true;
+        if (a.left < 0) return false;
+        return area(a.box) >= area(b.box);
+    }
+
+    bool adjacent(int s, int t) const
+    {
+        const vector<unsigned int>& idx = indices;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                if (idx[3 * s + i] == idx[3 * t + j]) return true;
+        return false;
+    }
+
+    void testTriangles(int s, int t, vector<TrianglePair>& out) const
+    {
+        if (!Overlap(triangleBoxes[s], triangleBoxes[t]) || adjacent(s, t)) return;
+        TrianglePair pair = { min(s, t), max(s, t) };
+        out.push_back(pair);
+    }
+
+    void selfTraverse(int n, vector<TrianglePair>& out) const
+    {
+        const BVHNode& node = nodes[n];
+        if (cannotFold(node)) return;
+        if (node.left < 0)
+        {
+            for (int i = 0; i < node.count; i++)
+                for (int j = i + 1; j < node.count; j++)
+                    testTriangles(triangleOrder[node.start + i], triangleOrder[node.start + j], out);
+            return;
+        }
+        selfTraverse(node.left, out);
+        selfTraverse(node.right, out);
+        pairTraverse(node.left, node.right, out);
+    }
+
+    void pairTraverse(int a, int b, vector<TrianglePair>& out) const
+    {
+        const BVHNode& na = nodes[a];
+        const BVHNode& nb = nodes[b];
+        if (!Overlap(na.box, nb.box) || cannotFold(na, nb)) return;
+        if (na.left < 0 && nb.left < 0)
+        {
+            for (int i = 0; i < na.count; i++)
+                for (int j = 0; j < nb.count; j++)
+                    testTriangles(triangleOrder[na.start + i], triangleOrder[nb.start + j], out);
+            return;
+        }
+        if (descendFirst(na, nb))
+        {
+            pairTraverse(na.left, b, out);
+            pairTraverse(na.right, b, out);
+        }
+        else
+        {
+            pairTraverse(a, nb.left, out);
+            pairTraverse(a, nb.right, out);
+        }
+    }
+};
+#endif
@@ -0,0 +1,186 @@
+#ifndef BATCH_SIMULATOR_H
+#define BATCH_SIMULATOR_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Topology.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// what differs between the instances of a batch
+struct ClothVariant {
+    float structuralCoef;
+    float bendingCoef;
+    float dampCoef;
+    glm::vec3 wind;         // as passed to SimulateWind, zero for none
+};
+
+// the state of one instance, everything else is shared
+struct ClothInstance {
+    ClothVariant variant;
+    vector<glm::vec3> position;
+    vector<glm::vec3> oldPos;
+    vector<glm::vec3> velocity;
+    vector<glm::vec3> force;
+};
+
+// Many variants of one cloth stepped side by side, e.g. for parameter sweeps. The springs, rest lengths and
+// pinned particles are set up once and only read while stepping; each instance owns nothing but its particle
+// arrays and parameters. Instances are independent, so a step hands whole instances to the threads and runs
+// every instance serially inside, with no locks or shared writes: throughput grows with the cores as long as
+// there are a few instances per core. An instance steps like the interactive loop does with wind, springs,
+// gravity, the ground plane, pinned corners and SimulateNodes, followed by the per frame reset of
+// updatePosition. The ground is the only collider: no ball, body, self or continuous collision.
+class ClothBatch
+{
+public:
+    glm::vec3 gravity = glm::vec3(0, -0.98f, 0);
+    int substeps = 1;
+    bool ground = true;
+    glm::vec3 groundPoint = glm::vec3(0, -10.5f, 0);    // the plane of the interactive scene, with the
+    glm::vec3 groundNormal = glm::vec3(0, 1, 0);        // defaults of ColliderSet::AddPlane and of the set
+    float friction = 0.3f;
+    float restitution = 0.2f;
+    float thickness = 0.02f;
+    float contactMargin = 0.01f;
+    vector<ClothInstance> instances;
+    float stepMs = 0;           // wall time of the last Step
+    long long instanceSteps = 0;
+
+    // rest positions from oldPos, like the springs of the interactive model
+    void SetTopology(const vector<Vertex>& vertices, const vector<Edge>& edges, const vector<Edge>& diagonals, const vector<int>& pinnedParticles)
+    {
+        rest.resize(vertices.size());
+        for (int i = 0; i < vertices.size(); i++)
+            rest[i] = vertices[i].oldPos;
+        springs.clear();
+        for (int i = 0; i < edges.size(); i++)
+            addSpring(edges[i], false);
+        for (int i = 0; i < diagonals.size(); i++)
+            addSpring(diagonals[i], true);
+        fixed.assign(vertices.size(), 0);
+        for (int i = 0; i < pinnedParticles.size(); i++)
+            if (pinnedParticles[i] >= 0) fixed[pinnedParticles[i]] = 1;
+        instances.clear();
+    }
+
+    // a new instance at rest
+    int AddInstance(const ClothVariant& variant)
+    {
+        ClothInstance instance;
+        instance.variant = variant;
+        instance.position = rest;
+        instance.oldPos = rest;
+        instance.velocity.assign(rest.size(), glm::vec3(0));
+        instance.force.assign(rest.size(), glm::vec3(0));
+        instances.push_back(instance);
+        return instances.size() - 1;
+    }
+
+    // one frame of every instance: substeps steps of etha each
+    void Step(float etha)
+    {
+        auto t0 = chrono::steady_clock::now();
+        ParallelFor(0, instances.size(), [&](int i) { stepInstance(instances[i], etha); }, 1);
+        instanceSteps += (long long)instances.size() * substeps;
+        stepMs = chrono::duration<float, milli>(chrono::steady_clock::now() - t0).count();
+    }
+
+private:
+    struct BatchSpring {
+        int first;
+        int second;
+        float rest;
+        bool bending;
+    };
+    vector<glm::vec3> rest;
+    vector<BatchSpring> springs;
+    vector<char> fixed;
+
+    void addSpring(const Edge& e, bool bending)
+    {
+        BatchSpring spring = { e.firstVertex, e.secondVertex, glm::length(rest[e.firstVertex] - rest[e.secondVertex]), bending };
+        springs.push_back(spring);
+    }
+
+    // the particles have unit mass, as updatePosition resets them to
+    void stepInstance(ClothInstance& instance, float etha) const
+    {
+        const ClothVariant& variant = instance.variant;
+        int n = rest.size();
+        glm::vec3* position = &instance.position[0];
+        glm::vec3* oldPos = &instance.oldPos[0];
+        glm::vec3* velocity = &instance.velocity[0];
+        glm::vec3* force = &instance.force[0];
+        glm::vec3 external = variant.wind * 2.5f + gravity * 20.0f;
+
+        for (int substep = 0; substep < substeps; substep++)
+        {
+            // Spring::Simulate
+            for (int s = 0; s < springs.size(); s++)
+            {
+                const BatchSpring& spring = springs[s];
+                glm::vec3 d = position[spring.second] - position[spring.first];
+                float length = glm::length(d);
+                if (length <= 0) continue;
+                glm::vec3 direction = d / length;
+                float hook = (length - spring.rest) * (spring.bending ? variant.bendingCoef : variant.structuralCoef);
+                float damp = glm::dot(direction, velocity[spring.second] - velocity[spring.first]) * variant.dampCoef;
+                glm::vec3 f = direction * (hook + damp);
+                force[spring.first] += f;
+                force[spring.second] -= f;
+            }
+
+            // SimulateCollision against the ground: the push out of ColliderSet::Resolve, then the velocity
+            // solve of ContactCache, which for the single plane contact of a particle is done in one iteration
+            if (ground)
+            {
+                for (int i = 0; i < n; i++)
+                {
+                    if (fixed[i]) continue;
+                    float phi = glm::dot(position[i] - groundPoint, groundNormal);
+                    if (phi >= thickness + contactMargin) continue;
+                    glm::vec3 correction = max(thickness - phi, 0.0f) * groundNormal;
+                    position[i] += correction;
+                    oldPos[i] += correction;
+
+                    float gap = max(phi - thickness, 0.0f);
+                    float vn = glm::dot(velocity[i], groundNormal);
+                    float target = gap > 0 ? -gap / etha : (vn < 0 ? -restitution * vn : 0.0f);
+                    float normalImpulse = max(target - vn, 0.0f);
+                    velocity[i] += normalImpulse * groundNormal;
+                    glm::vec3 slip = velocity[i] - glm::dot(velocity[i], groundNormal) * groundNormal;
+                    float length = glm::length(slip);
+                    float limit = friction * normalImpulse;
+                    velocity[i] -= length > limit ? slip * (limit / length) : slip;
+                }
+            }
+
+            // SimulateNodes, the pinned particles stay where they are
+            for (int i = 0; i < n; i++)
+            {
+                if (fixed[i])
+                {
+                    force[i] = glm::vec3(0);
+                    continue;
+                }
+                velocity[i] += (force[i] + external) * etha;
+                glm::vec3 temp = position[i];
+                position[i] += (position[i] - oldPos[i]) + velocity[i] * etha;
+                oldPos[i] = temp;
+                force[i] = glm::vec3(0);
+            }
+        }
+
+        // updatePosition
+        for (int i = 0; i < n; i++)
+            oldPos[i] = position[i];
+    }
+};
+#endif
@@ -0,0 +1,175 @@
+#ifndef BROAD_PHASE_H
+#define BROAD_PHASE_H
+
+#include <glm/glm.hpp>
+
+#include "BVH.h"
+
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+// proxy categories of the scene objects
+#define BROAD_PHASE_CLOTH 1u
+#define BROAD_PHASE_COLLIDER 2u
+
+struct BroadPhasePair {
+    int first;      // proxy ids, first < second
+    int second;
+};
+
+// Sweep and prune over whole objects (cloth pieces, colliders). The two end points of every box are kept
+// sorted along each axis and re-sorted by insertion sort each frame; since objects move little between
+// frames this is close to linear. A pair starts or stops overlapping exactly when two of its end points
+// swap, so the overlap set is updated from those swaps alone and the cost follows the number of changes
+// and interactions instead of the square of the object count.
+class SweepAndPrune
+{
+public:
+    vector<BroadPhasePair> pairs;
+
+    // category and mask filter the pairs as usual: a and b pair up when a.category & b.mask and b.category & a.mask
+    int Add(const AABB& box, int user, unsigned int category = 1, unsigned int mask = ~0u)
+    {
+        int id;
+        if (!freeIds.empty())
+        {
+            id = freeIds.back();
+            freeIds.pop_back();
+        }
+        else
+        {
+            id = proxies.size();
+            proxies.push_back(Proxy());
+        }
+        Proxy& proxy = proxies[id];
+        proxy.box = box;
+        proxy.user = user;
+        proxy.category = category;
+        proxy.mask = mask;
+        // new end points go to the back and are sorted into place, reporting their overlaps, by the next Run
+        for (int axis = 0; axis < 3; axis++)
+        {
+            Endpoint lo = { box.min[axis], id, false }, hi = { box.max[axis], id, true };
+            endpoints[axis].push_back(lo);
+            endpoints[axis].push_back(hi);
+        }
+        return id;
+    }
+
+    void Remove(int id)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            vector<Endpoint>& list = endpoints[axis];
+            list.erase(remove_if(list.begin(), list.end(), [id](const Endpoint& e) { return e.proxy == id; }), list.end());
+        }
+        for (auto it = overlaps.begin(); it != overlaps.end(); )
+        {
+            if (first(*it) == id || second(*it) == id) it = overlaps.erase(it);
+            else ++it;
+        }
+        freeIds.push_back(id);
+    }
+
+    void Update(int id, const AABB& box)
+    {
+        proxies[id].box = box;
+    }
+
+    int User(int id) const
+    {
+        return proxies[id].user;
+    }
+
+    unsigned int Category(int id) const
+    {
+        return proxies[id].category;
+    }
+
+    // re-sorts the end points and refreshes pairs
+    void Run()
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            vector<Endpoint>& list = endpoints[axis];
+            for (int i = 0; i < list.size(); i++)
+            {
+                const AABB& box = proxies[list[i].proxy].box;
+                list[i].value = list[i].isMax ? box.max[axis] : box.min[axis];
+            }
+            sortAxis(axis);
+        }
+
+        pairs.clear();
+        for (auto it = overlaps.begin(); it != overlaps.end(); ++it)
+        {
+            BroadPhasePair pair = { first(*it), second(*it) };
+            pairs.push_back(pair);
+        }
+    }
+
+private:
+    struct Proxy {
+        AABB box;
+        int user;
+        unsigned int category;
+        unsigned int mask;
+    };
+    struct Endpoint {
+        float value;
+        int proxy;
+        bool isMax;
+    };
+
+    vector<Proxy> proxies;
+    vector<int> freeIds;
+    vector<Endpoint> endpoints[3];
+    unordered_set<uint64_t> overlaps;
+
+    static uint64_t key(int a, int b)
+    {
+        if (a > b) swap(a, b);
+        return ((uint64_t)a << 32) | (uint32_t)b;
+    }
+
+    static int first(uint64_t k) { return (int)(k >> 32); }
+    static int second(uint64_t k) { return (int)(k & 0xffffffffu); }
+
+    bool accepts(int a, int b) const
+    {
+        return (proxies[a].category & proxies[b].mask) && (proxies[b].category & proxies[a].mask);
+    }
+
+    // insertion sort of one axis; every swap of a min and a max end point is an overlap starting or ending
+    void sortAxis(int axis)
+    {
+        vector<Endpoint>& list = endpoints[axis];
+        for (int i = 1; i < list.size(); i++)
+        {
+            Endpoint moving = list[i];
+            int j = i - 1;
+            while (j >= 0 && list[j].value > moving.value)
+            {
+                const Endpoint& passed = list[j];
+                if (!moving.isMax && passed.isMax)
+                {
+                    // a min moved below another box's max: they may overlap now, the box values settle the other axes
+                    if (accepts(moving.proxy, passed.proxy) && Overlap(proxies[moving.proxy].box, proxies[passed.proxy].box))
+                        overlaps.insert(key(moving.proxy, passed.proxy));
+                }
+                else if (moving.isMax && !passed.isMax)
+                {
+                    // a max moved below another box's min: separated on this axis
+                    overlaps.erase(key(moving.proxy, passed.proxy));
+                }
+                list[j + 1] = list[j];
+                j--;
+            }
+            list[j + 1] = moving;
+        }
+    }
+};
+#endif
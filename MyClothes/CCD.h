@@ -0,0 +1,345 @@
+#ifndef CCD_H
+#define CCD_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "BVH.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// roots of c0 + c1 t + c2 t^2 + c3 t^3 in [0, 1], ascending. The interval is cut at the roots of the
+// derivative so every piece is monotone and a sign change is bracketed, then each piece is bisected.
+inline int CubicRoots(float c0, float c1, float c2, float c3, float roots[3])
+{
+    float cuts[4] = { 0, 0, 0, 1 };
+    int cutCount = 1;
+    // derivative c1 + 2 c2 t + 3 c3 t^2
+    float a = 3 * c3, b = 2 * c2, c = c1;
+    if (fabsf(a) > 1e-12f)
+    {
+        float disc = b * b - 4 * a * c;
+        if (disc > 0)
+        {
+            float s = sqrtf(disc);
+            float r0 = (-b - s) / (2 * a), r1 = (-b + s) / (2 * a);
+            if (r0 > r1) swap(r0, r1);
+            if (r0 > 0 && r0 < 1) cuts[cutCount++] = r0;
+            if (r1 > 0 && r1 < 1) cuts[cutCount++] = r1;
+        }
+    }
+    else if (fabsf(b) > 1e-12f)
+    {
+        float r = -c / b;
+        if (r > 0 && r < 1) cuts[cutCount++] = r;
+    }
+    cuts[cutCount++] = 1;
+
+    auto f = [&](float t) { return c0 + t * (c1 + t * (c2 + t * c3)); };
+    int count = 0;
+    for (int i = 0; i + 1 < cutCount; i++)
+    {
+        float lo = cuts[i], hi = cuts[i + 1];
+        float flo = f(lo), fhi = f(hi);
+        if (flo == 0) { if (count == 0 || roots[count - 1] != lo) roots[count++] = lo; continue; }
+        if ((flo > 0) == (fhi > 0)) continue;
+        for (int k = 0; k < 32; k++)
+        {
+            float mid = 0.5f * (lo + hi);
+            float fmid = f(mid);
+            if ((fmid > 0) == (flo > 0)) { lo = mid; flo = fmid; }
+            else hi = mid;
+        }
+        roots[count++] = hi;
+    }
+    if (count < 3 && f(1) == 0 && (count == 0 || roots[count - 1] != 1))
+        roots[count++] = 1;
+    return count;
+}
+
+// coefficients of det[x1 - x0, x2 - x0, x3 - x0] for points moving linearly from x_i to x_i + v_i
+inline void CoplanarityCubic(const glm::vec3 x[4], const glm::vec3 v[4], float coefficients[4])
+{
+    glm::vec3 a = x[1] - x[0], b = x[2] - x[0], c = x[3] - x[0];
+    glm::vec3 da = v[1] - v[0], db = v[2] - v[0], dc = v[3] - v[0];
+    glm::vec3 A0 = glm::cross(a, b);
+    glm::vec3 A1 = glm::cross(a, db) + glm::cross(da, b);
+    glm::vec3 A2 = glm::cross(da, db);
+    coefficients[0] = glm::dot(A0, c);
+    coefficients[1] = glm::dot(A0, dc) + glm::dot(A1, c);
+    coefficients[2] = glm::dot(A1, dc) + glm::dot(A2, c);
+    coefficients[3] = glm::dot(A2, dc);
+}
+
+// closest points of segments p0p1 and q0q1 (Ericson, Real-Time Collision Detection 5.1.9)
+inline void ClosestSegmentParameters(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& q0, const glm::vec3& q1, float& s, float& t)
+{
+    glm::vec3 d1 = p1 - p0, d2 = q1 - q0, r = p0 - q0;
+    float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+    if (a <= 1e-12f && e <= 1e-12f) { s = t = 0; return; }
+    if (a <= 1e-12f) { s = 0; t = glm::clamp(f / e, 0.0f, 1.0f); return; }
+    float c = glm::dot(d1, r);
+    if (e <= 1e-12f) { t = 0; s = glm::clamp(-c / a, 0.0f, 1.0f); return; }
+    float b = glm::dot(d1, d2);
+    float denom = a * e - b * b;
+    s = denom != 0 ? glm::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+    t = (b * s + f) / e;
+    if (t < 0) { t = 0; s = glm::clamp(-c / a, 0.0f, 1.0f); }
+    else if (t > 1) { t = 1; s = glm::clamp((b - c) / a, 0.0f, 1.0f); }
+}
+
+// barycentric coordinates of the projection of p onto triangle abc
+inline glm::vec3 Barycentric(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    glm::vec3 v0 = b - a, v1 = c - a, v2 = p - a;
+    float d00 = glm::dot(v0, v0), d01 = glm::dot(v0, v1), d11 = glm::dot(v1, v1);
+    float d20 = glm::dot(v2, v0), d21 = glm::dot(v2, v1);
+    float denom = d00 * d11 - d01 * d01;
+    if (fabsf(denom) < 1e-20f) return glm::vec3(-1);
+    float v = (d11 * d20 - d01 * d21) / denom;
+    float w = (d00 * d21 - d01 * d20) / denom;
+    return glm::vec3(1 - v - w, v, w);
+}
+
+// A collision found by the continuous test. The weights are chosen so that sum(weight[i] * x[i]) is the
+// separation between the two features: (1, -u, -v, -w) for a vertex and triangle, (1-s, s, t-1, -t) for two edges.
+struct Impact {
+    int vertex[4];
+    float weight[4];
+    float time;
+    glm::vec3 normal;
+};
+
+// first time in [0, 1] at which vertex p passes within tolerance of triangle abc
+inline bool VertexTriangleCCD(const glm::vec3 x[4], const glm::vec3 v[4], float tolerance, float& time, glm::vec3& normal, glm::vec3& weights)
+{
+    float coefficients[4], roots[3];
+    CoplanarityCubic(x, v, coefficients);
+    int count = CubicRoots(coefficients[0], coefficients[1], coefficients[2], coefficients[3], roots);
+    for (int i = 0; i < count; i++)
+    {
+        float t = roots[i];
+        glm::vec3 p = x[0] + t * v[0], a = x[1] + t * v[1], b = x[2] + t * v[2], c = x[3] + t * v[3];
+        glm::vec3 bary = Barycentric(p, a, b, c);
+        glm::vec3 edgeTolerance = glm::vec3(tolerance) / glm::max(glm::vec3(glm::length(b - c), glm::length(c - a), glm::length(a - b)), glm::vec3(1e-6f));
+        if (bary.x < -edgeTolerance.x || bary.y < -edgeTolerance.y || bary.z < -edgeTolerance.z) continue;
+        glm::vec3 q = bary.x * a + bary.y * b + bary.z * c;
+        if (glm::length(p - q) > tolerance) continue;
+
+        normal = glm::cross(b - a, c - a);
+        float len = glm::length(normal);
+        if (len < 1e-12f) continue;
+        normal /= len;
+        // orient the normal along the separation at the start of the step
+        glm::vec3 start = x[0] - (bary.x * x[1] + bary.y * x[2] + bary.z * x[3]);
+        if (glm::dot(start, normal) < 0) normal = -normal;
+        time = t;
+        weights = bary;
+        return true;
+    }
+    return false;
+}
+
+// first time in [0, 1] at which edges p0p1 and q0q1 pass within tolerance of each other
+inline bool EdgeEdgeCCD(const glm::vec3 x[4], const glm::vec3 v[4], float tolerance, float& time, glm::vec3& normal, float& s, float& u)
+{
+    float coefficients[4], roots[3];
+    CoplanarityCubic(x, v, coefficients);
+    int count = CubicRoots(coefficients[0], coefficients[1], coefficients[2], coefficients[3], roots);
+    for (int i = 0; i < count; i++)
+    {
+        float t = roots[i];
+        glm::vec3 p0 = x[0] + t * v[0], p1 = x[1] + t * v[1], q0 = x[2] + t * v[2], q1 = x[3] + t * v[3];
+        ClosestSegmentParameters(p0, p1, q0, q1, s, u);
+        glm::vec3 d = (p0 + s * (p1 - p0)) - (q0 + u * (q1 - q0));
+        if (glm::length(d) > tolerance) continue;
+
+        normal = glm::cross(p1 - p0, q1 - q0);
+        float len = glm::length(normal);
+        if (len < 1e-12f) continue;
+        normal /= len;
+        glm::vec3 start = (x[0] + s * (x[1] - x[0])) - (x[2] + u * (x[3] - x[2]));
+        if (glm::dot(start, normal) < 0) normal = -normal;
+        time = t;
+        return true;
+    }
+    return false;
+}
+
+// Self collision over a whole step: the cloth BVH is refitted with boxes swept from oldPos to Position,
+// and only vertex-triangle and edge-edge pairs of overlapping swept boxes run the cubic test. Vertices in
+// a collision are rolled back along their path to just before the earliest impact and lose their
+// approaching normal velocity; this is repeated a few times and whatever remains is left in `impacts`.
+class ContinuousCollision
+{
+public:
+    float tolerance = 1e-3f;
+    float safety = 0.9f;
+    int maxIterations = 3;
+    vector<Impact> impacts;
+    int iterations = 0;
+
+    void Resolve(vector<Vertex>& vertices, const vector<unsigned int>& indices, TriangleBVH& bvh)
+    {
+        iterations = 0;
+        for (;;)
+        {
+            Detect(vertices, indices, bvh);
+            if (impacts.empty() || iterations == maxIterations) break;
+            respond(vertices);
+            iterations++;
+        }
+    }
+
+    void Detect(const vector<Vertex>& vertices, const vector<unsigned int>& indices, TriangleBVH& bvh)
+    {
+        if (triangleEdges.size() != indices.size())
+            buildEdgeIds(indices);
+        bvh.Refit(vertices, true);
+        bvh.SelfCollide(pairs);
+
+        // unique vertex-triangle and edge-edge tests of the candidate triangle pairs
+        tests.clear();
+        seen.clear();
+        for (int i = 0; i < pairs.size(); i++)
+        {
+            int s = pairs[i].first, t = pairs[i].second;
+            for (int k = 0; k < 3; k++)
+            {
+                addTest(VERTEX_TRIANGLE, indices[3 * s + k], t, indices);
+                addTest(VERTEX_TRIANGLE, indices[3 * t + k], s, indices);
+                for (int l = 0; l < 3; l++)
+                    addEdgeTest(3 * s + k, 3 * t + l, indices);
+            }
+        }
+
+        found.resize(tests.size());
+        hit.resize(tests.size());
+        ParallelFor(0, tests.size(), [&](int i)
+            {
+                const Test& test = tests[i];
+                glm::vec3 x[4], v[4];
+                for (int k = 0; k < 4; k++)
+                {
+                    x[k] = vertices[test.vertex[k]].oldPos;
+                    v[k] = vertices[test.vertex[k]].Position - x[k];
+                }
+                Impact& impact = found[i];
+                for (int k = 0; k < 4; k++) impact.vertex[k] = test.vertex[k];
+                if (test.type == VERTEX_TRIANGLE)
+                {
+                    glm::vec3 bary;
+                    hit[i] = VertexTriangleCCD(x, v, tolerance, impact.time, impact.normal, bary);
+                    impact.weight[0] = 1;
+                    impact.weight[1] = -bary.x;
+                    impact.weight[2] = -bary.y;
+                    impact.weight[3] = -bary.z;
+                }
+                else
+                {
+                    float s, u;
+                    hit[i] = EdgeEdgeCCD(x, v, tolerance, impact.time, impact.normal, s, u);
+                    impact.weight[0] = 1 - s;
+                    impact.weight[1] = s;
+                    impact.weight[2] = u - 1;
+                    impact.weight[3] = -u;
+                }
+            }, 256);
+
+        impacts.clear();
+        for (int i = 0; i < tests.size(); i++)
+            if (hit[i]) impacts.push_back(found[i]);
+    }
+
+private:
+    enum TestType { VERTEX_TRIANGLE, EDGE_EDGE };
+    struct Test {
+        TestType type;
+        int vertex[4];
+    };
+    vector<TrianglePair> pairs;
+    vector<Test> tests;
+    vector<Impact> found;
+    vector<char> hit;
+    unordered_set<uint64_t> seen;
+    vector<int> triangleEdges;
+    vector<float> rollback;
+
+    void addTest(TestType type, int p, int triangle, const vector<unsigned int>& indices)
+    {
+        if (!seen.insert(((uint64_t)p << 32) | (uint32_t)triangle).second) return;
+        Test test = { type, { p, (int)indices[3 * triangle], (int)indices[3 * triangle + 1], (int)indices[3 * triangle + 2] } };
+        tests.push_back(test);
+    }
+
+    // edge k of triangle t is triangleEdges[3 * t + k], shared edges get the same id
+    void buildEdgeIds(const vector<unsigned int>& indices)
+    {
+        unordered_map<uint64_t, int> ids;
+        triangleEdges.resize(indices.size());
+        for (int i = 0; i < indices.size(); i++)
+        {
+            uint64_t a = indices[i], b = indices[i - i % 3 + (i + 1) % 3];
+            uint64_t key = a < b ? (a << 32) | b : (b << 32) | a;
+            auto found = ids.insert(make_pair(key, (int)ids.size())).first;
+            triangleEdges[i] = found->second;
+        }
+    }
+
+    // corner slots i and j name the edges starting at indices[i] and indices[j]
+    void addEdgeTest(int i, int j, const vector<unsigned int>& indices)
+    {
+        int p0 = indices[i], p1 = indices[i - i % 3 + (i + 1) % 3];
+        int q0 = indices[j], q1 = indices[j - j % 3 + (j + 1) % 3];
+        if (p0 == q0 || p0 == q1 || p1 == q0 || p1 == q1) return;
+        uint64_t e0 = triangleEdges[i], e1 = triangleEdges[j];
+        if (e0 > e1) swap(e0, e1);
+        // edge pairs use the top bit so they never collide with vertex-triangle keys
+        if (!seen.insert((1ull << 63) | (e0 << 32) | e1).second) return;
+        Test test = { EDGE_EDGE, { p0, p1, q0, q1 } };
+        tests.push_back(test);
+    }
+
+    void respond(vector<Vertex>& vertices)
+    {
+        rollback.assign(vertices.size(), 1.0f);
+        for (int i = 0; i < impacts.size(); i++)
+        {
+            const Impact& impact = impacts[i];
+            for (int k = 0; k < 4; k++)
+                rollback[impact.vertex[k]] = min(rollback[impact.vertex[k]], impact.time);
+
+            // inelastic impulse on the relative normal velocity, fixed vertices act as infinite mass
+            glm::vec3 relative(0);
+            float weightSum = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                const Vertex& vertex = vertices[impact.vertex[k]];
+                relative += impact.weight[k] * vertex.velocity;
+                if (!vertex.isFixed) weightSum += impact.weight[k] * impact.weight[k];
+            }
+            float vn = glm::dot(relative, impact.normal);
+            if (vn >= 0 || weightSum == 0) continue;
+            for (int k = 0; k < 4; k++)
+            {
+                Vertex& vertex = vertices[impact.vertex[k]];
+                if (!vertex.isFixed)
+                    vertex.velocity -= (impact.weight[k] * vn / weightSum) * impact.normal;
+            }
+        }
+
+        ParallelFor(0, vertices.size(), [&](int i)
+            {
+                if (rollback[i] >= 1.0f || vertices[i].isFixed) return;
+                vertices[i].Position = vertices[i].oldPos + (vertices[i].Position - vertices[i].oldPos) * (rollback[i] * safety);
+            }, 2048);
+    }
+};
+#endif
@@ -0,0 +1,144 @@
+#ifndef CLOTH_CROWD_H
+#define CLOTH_CROWD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "RenderVertex.h"
+#include "Normals.h"
+#include "BatchSimulator.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <cstddef>
+#include <chrono>
+using namespace std;
+
+// the packed instances of one crowd frame, handed from the simulation side to the render loop
+struct CrowdFrame {
+    vector<RenderVertex> stream;
+    float stepMs = 0;                   // of the batch step that produced it
+    float packMs = 0;                   // normals and packing
+};
+
+// Draws every instance of a ClothBatch with a single call, however many there are. The instances share one
+// topology, so they are packed back to back into one dynamic vertex buffer, instance i from vertex
+// i * vertexCount on, in the compact RenderVertex form and moved by its offset. The index buffer holds the
+// triangles of one cloth only; glMultiDrawElementsBaseVertex (core since GL 3.2) draws it once per instance
+// with that base added to every index. The base offsets the texture coordinates too, so they are repeated
+// per instance into a static buffer. The layout matches Mesh, so the cloth shader draws it unchanged.
+//
+// Packing is CPU work and belongs to whichever thread steps the batch; it fills a CrowdFrame that reaches
+// the render loop through a TripleBuffer, like SimulationFrame. The render side only uploads the newest one.
+class ClothCrowd
+{
+public:
+    vector<glm::vec3> offsets;          // where each instance is drawn
+
+    void Setup(const vector<Vertex>& vertices, const vector<unsigned int>& indices, const vector<glm::vec3>& instanceOffsets)
+    {
+        offsets = instanceOffsets;
+        this->indices = indices;
+        vertexCount = vertices.size();
+        int instanceCount = offsets.size();
+        normals.SetTopology(vertexCount, indices);
+        faceScratch.resize(instanceCount);
+        normalScratch.resize(instanceCount);
+        size_t streamSize = (size_t)vertexCount * instanceCount;
+
+        vector<glm::vec2> texCoords((size_t)vertexCount * instanceCount);
+        counts.assign(instanceCount, (GLsizei)indices.size());
+        firstIndices.assign(instanceCount, (const void*)0);
+        baseVertices.resize(instanceCount);
+        for (int i = 0; i < instanceCount; i++)
+        {
+            baseVertices[i] = i * vertexCount;
+            for (int v = 0; v < vertexCount; v++)
+                texCoords[baseVertices[i] + v] = vertices[v].TexCoords;
+        }
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &texCoordVBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, streamSize * sizeof(RenderVertex), NULL, GL_DYNAMIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RenderVertex), (void*)offsetof(RenderVertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(RenderVertex), (void*)offsetof(RenderVertex, Normal));
+
+        glBindBuffer(GL_ARRAY_BUFFER, texCoordVBO);
+        glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), &texCoords[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // packs the current instances of the batch into the frame, one instance per task; no GL calls, so it runs
+    // on the thread that steps the batch
+    void Pack(const ClothBatch& batch, CrowdFrame& frame)
+    {
+        auto t0 = chrono::steady_clock::now();
+        vector<RenderVertex>& stream = frame.stream;
+        stream.resize((size_t)vertexCount * offsets.size());
+        ParallelFor(0, offsets.size(), [&](int i)
+            {
+                const vector<glm::vec3>& position = batch.instances[i].position;
+                vector<glm::vec3>& instanceNormals = normalScratch[i];
+                normals.Compute(position, indices, faceScratch[i], instanceNormals);
+                RenderVertex* packed = &stream[(size_t)i * vertexCount];
+                for (int v = 0; v < vertexCount; v++)
+                {
+                    packed[v].Position = position[v] + offsets[i];
+                    OctahedralEncode(instanceNormals[v], packed[v].Normal);
+                }
+            }, 1);
+        frame.packMs = chrono::duration<float, milli>(chrono::steady_clock::now() - t0).count();
+    }
+
+    // on the render thread: uploads a packed frame
+    void Upload(const CrowdFrame& frame)
+    {
+        if (frame.stream.empty()) return;
+        // orphan the old storage so the upload does not wait for the frame still drawing from it
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, frame.stream.size() * sizeof(RenderVertex), NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, frame.stream.size() * sizeof(RenderVertex), &frame.stream[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        uploaded = true;
+    }
+
+    // the whole crowd, with the program and textures already bound; nothing before the first Upload
+    void Draw() const
+    {
+        if (!uploaded) return;
+        glBindVertexArray(VAO);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, &counts[0], GL_UNSIGNED_INT, &firstIndices[0], (GLsizei)counts.size(), &baseVertices[0]);
+        glBindVertexArray(0);
+    }
+
+    int InstanceCount() const
+    {
+        return offsets.size();
+    }
+
+private:
+    unsigned int VAO = 0, VBO = 0, texCoordVBO = 0, EBO = 0;
+    int vertexCount = 0;
+    bool uploaded = false;
+    vector<GLsizei> counts;             // per instance draw: the whole index buffer from its base vertex on
+    vector<const void*> firstIndices;
+    vector<GLint> baseVertices;
+    vector<unsigned int> indices;       // of one instance
+    VertexNormals normals;              // adjacency shared by all instances
+    vector<vector<glm::vec3>> faceScratch, normalScratch;   // per instance, so instances are packed in parallel
+};
+#endif
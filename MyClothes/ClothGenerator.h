@@ -0,0 +1,174 @@
+#ifndef CLOTH_GENERATOR_H
+#define CLOTH_GENERATOR_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Topology.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <cmath>
+using namespace std;
+
+// Simulation ready cloth: vertices and triangles plus the same connectivity vertexSort derives from a loaded
+// mesh, i.e. the triangle edges (structural springs, including one shear diagonal per quad), the pairs of
+// triangles sharing an edge, and for each such pair its two opposite vertices (bending springs; inside a
+// quad this is the other shear diagonal).
+struct ClothGrid {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    vector<Edge> edges;
+    vector<Edge> diagonals;
+    vector<Neighbour> neighbours;
+    int anchors[2];     // two vertices on the far edge to pin the cloth by
+};
+
+// A grid of columns x rows quads in the xz plane, centred on the origin, with some quads masked out.
+// Quad (i, j) has corners a = (i, j), b = (i, j + 1), c = (i + 1, j), d = (i + 1, j + 1) and is split into
+// the triangles (a, c, b) and (b, c, d). Every quad owns its right, bottom and diagonal edges, and its top
+// and left ones only where there is no quad above or to the left, so each item has exactly one writer and
+// everything is placed by prefix sums and filled in parallel.
+class ClothGenerator
+{
+public:
+    static void Rectangle(int columns, int rows, float width, float height, ClothGrid& grid)
+    {
+        vector<char> mask(columns * rows, 1);
+        Masked(columns, rows, width, height, mask, grid);
+        grid.anchors[0] = rows * (columns + 1);
+        grid.anchors[1] = rows * (columns + 1) + columns;
+    }
+
+    // a disc cut from a resolution x resolution grid, keeping the quads whose centre lies inside the circle
+    static void Circle(int resolution, float radius, ClothGrid& grid)
+    {
+        vector<char> mask(resolution * resolution);
+        float half = 0.5f * resolution;
+        for (int i = 0; i < resolution; i++)
+            for (int j = 0; j < resolution; j++)
+            {
+                float x = j + 0.5f - half, z = i + 0.5f - half;
+                mask[i * resolution + j] = x * x + z * z <= half * half;
+            }
+        Masked(resolution, resolution, 2 * radius, 2 * radius, mask, grid);
+
+        // pin the rim vertices furthest along -x and +x on the middle row
+        grid.anchors[0] = grid.anchors[1] = 0;
+        float lo = INFINITY, hi = -INFINITY;
+        for (int v = 0; v < grid.vertices.size(); v++)
+        {
+            const glm::vec3& p = grid.vertices[v].Position;
+            if (fabsf(p.z) > radius / resolution) continue;
+            if (p.x < lo) { lo = p.x; grid.anchors[0] = v; }
+            if (p.x > hi) { hi = p.x; grid.anchors[1] = v; }
+        }
+    }
+
+    static void Masked(int columns, int rows, float width, float height, const vector<char>& mask, ClothGrid& grid)
+    {
+        int stride = columns + 1;
+        auto valid = [&](int i, int j) { return i >= 0 && j >= 0 && i < rows && j < columns && mask[i * columns + j]; };
+
+        // vertices: kept when any of the four quads around them is
+        vector<int> vertexIndex((rows + 1) * stride);
+        int vertexCount = 0;
+        for (int i = 0; i <= rows; i++)
+            for (int j = 0; j <= columns; j++)
+            {
+                bool used = valid(i - 1, j - 1) || valid(i - 1, j) || valid(i, j - 1) || valid(i, j);
+                vertexIndex[i * stride + j] = used ? vertexCount++ : -1;
+            }
+
+        // per quad offsets into the triangle, edge and neighbour lists
+        int quadCount = columns * rows;
+        vector<int> quadIndex(quadCount), edgeStart(quadCount), neighbourStart(quadCount);
+        int quads = 0, edgeCount = 0, neighbourCount = 0;
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < columns; j++)
+            {
+                int q = i * columns + j;
+                quadIndex[q] = quads;
+                edgeStart[q] = edgeCount;
+                neighbourStart[q] = neighbourCount;
+                if (!mask[q]) continue;
+                quads++;
+                edgeCount += 3 + !valid(i - 1, j) + !valid(i, j - 1);
+                neighbourCount += 1 + valid(i, j + 1) + valid(i + 1, j);
+            }
+
+        // value initialised, so every field the loops below do not set starts at zero
+        grid.vertices.clear();
+        grid.vertices.resize(vertexCount);
+        grid.indices.resize(6 * quads);
+        grid.edges.resize(edgeCount);
+        grid.diagonals.resize(neighbourCount);
+        grid.neighbours.resize(neighbourCount);
+
+        ParallelFor(0, rows + 1, [&](int i)
+            {
+                for (int j = 0; j <= columns; j++)
+                {
+                    int v = vertexIndex[i * stride + j];
+                    if (v < 0) continue;
+                    Vertex& vertex = grid.vertices[v];
+                    vertex.Position = glm::vec3(width * ((float)j / columns - 0.5f), 0.0f, height * ((float)i / rows - 0.5f));
+                    vertex.Normal = glm::vec3(0, 1, 0);
+                    vertex.TexCoords = glm::vec2((float)j / columns, (float)i / rows);
+                    vertex.Tangent = glm::vec3(1, 0, 0);
+                    vertex.Bitangent = glm::vec3(0, 0, 1);
+                    vertex.mass = 1;
+                    vertex.oldPos = vertex.Position;
+                }
+            }, 16);
+
+        ParallelFor(0, rows, [&](int i)
+            {
+                for (int j = 0; j < columns; j++)
+                {
+                    int q = i * columns + j;
+                    if (!mask[q]) continue;
+                    int a = vertexIndex[i * stride + j], b = vertexIndex[i * stride + j + 1];
+                    int c = vertexIndex[(i + 1) * stride + j], d = vertexIndex[(i + 1) * stride + j + 1];
+                    int t0 = 2 * quadIndex[q], t1 = t0 + 1;
+
+                    unsigned int* tri = &grid.indices[3 * t0];
+                    tri[0] = a; tri[1] = c; tri[2] = b;
+                    tri[3] = b; tri[4] = c; tri[5] = d;
+
+                    Edge* e = &grid.edges[edgeStart[q]];
+                    *e++ = makeEdge(b, d);
+                    *e++ = makeEdge(c, d);
+                    *e++ = makeEdge(b, c);
+                    if (!valid(i - 1, j)) *e++ = makeEdge(a, b);
+                    if (!valid(i, j - 1)) *e++ = makeEdge(a, c);
+
+                    // the pair across the quad diagonal, then across the right and bottom edges
+                    int n = neighbourStart[q];
+                    setNeighbour(grid, n++, t0, t1, a, d);
+                    if (valid(i, j + 1))
+                        setNeighbour(grid, n++, t1, 2 * quadIndex[q + 1], c, vertexIndex[i * stride + j + 2]);
+                    if (valid(i + 1, j))
+                        setNeighbour(grid, n++, t1, 2 * quadIndex[q + columns], b, vertexIndex[(i + 2) * stride + j]);
+                }
+            }, 16);
+
+        grid.anchors[0] = 0;
+        grid.anchors[1] = vertexCount > 0 ? vertexCount - 1 : 0;
+    }
+
+private:
+    static Edge makeEdge(int first, int second)
+    {
+        Edge e = { first, second };
+        return e;
+    }
+
+    static void setNeighbour(ClothGrid& grid, int n, int firstTriangle, int secondTriangle, int firstVertex, int secondVertex)
+    {
+        Neighbour pair = { firstTriangle, secondTriangle };
+        grid.neighbours[n] = pair;
+        grid.diagonals[n] = makeEdge(firstVertex, secondVertex);
+    }
+};
+#endif
@@ -0,0 +1,211 @@
+// Command line runner for cloth jobs on machines without a display or GPU. It links the simulation library
+// (ClothSim: model.h and what it includes, plus Spring.cpp) and Assimp for loading meshes, no GL, GLFW or ImGui; e.g.
+//     g++ -std=c++14 -O2 -pthread ClothRunner.cpp Spring.cpp -lassimp -o ClothRunner
+//
+// ClothRunner (mesh.obj | --grid N | --circle N) [options]
+//     --steps N               frames to simulate (600)
+//     --substeps N            steps per frame (1)
+//     --dt h                  step size (0.0016)
+//     --structural k, --bending k, --damping c    spring coefficients
+//     --wind x y z            constant wind, as the Use Wind test applies it
+//     --pin a b               particles held in place, -1 for none; a generated cloth is held by its far corners
+//     --projective            implicit projective dynamics in place of the explicit springs
+//     --self-collision
+//     --out file.obj          the cloth after the last frame
+//     --timings file.csv      milliseconds per frame for every phase
+
+#include <glm/glm.hpp>
+#include "model.h"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+static double elapsedMs(chrono::steady_clock::time_point& since)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double ms = chrono::duration<double, milli>(now - since).count();
+    since = now;
+    return ms;
+}
+
+static bool writeObj(const Model& model, const string& path)
+{
+    ofstream file(path);
+    if (!file) return false;
+    const Mesh& mesh = model.meshes[0];
+    for (int i = 0; i < mesh.vertices.size(); i++)
+    {
+        const glm::vec3& p = mesh.vertices[i].Position;
+        file << "v " << p.x << " " << p.y << " " << p.z << "\n";
+    }
+    for (int i = 0; i + 2 < mesh.indices.size(); i += 3)
+        file << "f " << mesh.indices[i] + 1 << " " << mesh.indices[i + 1] + 1 << " " << mesh.indices[i + 2] + 1 << "\n";
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* meshPath = NULL;
+    const char* outPath = NULL;
+    const char* timingsPath = NULL;
+    int clothResolution = 0;
+    bool circularCloth = false;
+    int steps = 600;
+    int substeps = 1;
+    float timeStep = 0.0016f;
+    bool useWind = false;
+    glm::vec3 wind(0);
+    int pins[2] = { -1, -1 };
+    bool pinsGiven = false;
+    bool useProjective = false;
+    bool useSelfCollision = false;
+
+    Model ourModel;
+    for (int i = 1; i < argc; i++)
+    {
+        bool value = i + 1 < argc;
+        if ((strcmp(argv[i], "--grid") == 0 || strcmp(argv[i], "--circle") == 0) && value)
+        {
+            circularCloth = strcmp(argv[i], "--circle") == 0;
+            clothResolution = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--steps") == 0 && value)
+            steps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--substeps") == 0 && value)
+            substeps = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--dt") == 0 && value)
+            timeStep = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--structural") == 0 && value)
+            ourModel.structuralCoef = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--bending") == 0 && value)
+            ourModel.bendingCoef = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--damping") == 0 && value)
+            ourModel.dampCoef = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--wind") == 0 && i + 3 < argc)
+        {
+            useWind = true;
+            wind.x = (float)atof(argv[++i]);
+            wind.y = (float)atof(argv[++i]);
+            wind.z = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--pin") == 0 && i + 2 < argc)
+        {
+            pinsGiven = true;
+            pins[0] = atoi(argv[++i]);
+            pins[1] = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--projective") == 0)
+            useProjective = true;
+        else if (strcmp(argv[i], "--self-collision") == 0)
+            useSelfCollision = true;
+        else if (strcmp(argv[i], "--out") == 0 && value)
+            outPath = argv[++i];
+        else if (strcmp(argv[i], "--timings") == 0 && value)
+            timingsPath = argv[++i];
+        else if (argv[i][0] != '-')
+            meshPath = argv[i];
+        else
+        {
+            cerr << "unknown or incomplete option " << argv[i] << endl;
+            return 1;
+        }
+    }
+    if (!meshPath && clothResolution <= 0)
+    {
+        cerr << "usage: ClothRunner (mesh.obj | --grid N | --circle N) [--steps N] [--substeps N] [--dt h] [--structural k] [--bending k] [--damping c]" << endl
+            << "    [--wind x y z] [--pin a b] [--projective] [--self-collision] [--out file.obj] [--timings file.csv]" << endl;
+        return 1;
+    }
+
+    chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+    if (clothResolution > 0)
+    {
+        ClothGrid clothGrid;
+        if (circularCloth)
+            ClothGenerator::Circle(clothResolution, 1.0f, clothGrid);
+        else
+            ClothGenerator::Rectangle(clothResolution, clothResolution, 2.0f, 2.0f, clothGrid);
+        ourModel.LoadCloth(clothGrid);
+    }
+    else
+    {
+        ourModel.Load(meshPath);
+        if (ourModel.meshes.empty())
+        {
+            cerr << "no mesh in " << meshPath << endl;
+            return 1;
+        }
+        ourModel.read();
+        ourModel.vertexSort();
+    }
+    if (pinsGiven)
+    {
+        ourModel.cloths[0].anchors[0] = pins[0];
+        ourModel.cloths[0].anchors[1] = pins[1];
+    }
+    ourModel.CreateSpring();
+    ourModel.SetupSelfCollision();
+    ourModel.SetupProjective();
+    double setupMs = elapsedMs(clock);
+    cout << ourModel.meshes[0].vertices.size() << " particles, " << ourModel.springs.size() << " springs, set up in " << setupMs << " ms" << endl;
+
+    ofstream timings;
+    if (timingsPath)
+    {
+        timings.open(timingsPath);
+        timings << "frame,forces_ms,integrate_ms,self_collision_ms,frame_ms" << endl;
+    }
+    double totalMs = 0;
+    for (int frame = 0; frame < steps; frame++)
+    {
+        double forcesMs = 0, integrateMs = 0, selfCollisionMs = 0;
+        chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+        clock = frameStart;
+        for (int substep = 0; substep < substeps; substep++)
+        {
+            if (useWind)
+                ourModel.SimulateWind(wind);
+            if (!useProjective)
+                ourModel.SimulateInternalForce(timeStep);
+            ourModel.SimulateGravity();
+            for (int c = 0; c < ourModel.cloths.size(); c++)
+                ourModel.SimulateCorners(ourModel.cloths[c].anchors[0], ourModel.cloths[c].anchors[1]);
+            forcesMs += elapsedMs(clock);
+
+            if (useProjective)
+                ourModel.SimulateProjective(timeStep);
+            else
+                ourModel.SimulateNodes(timeStep);
+            integrateMs += elapsedMs(clock);
+
+            if (useSelfCollision)
+            {
+                ourModel.SimulateSelfCollision();
+                ourModel.FindSelfCollisionPairs();
+                selfCollisionMs += elapsedMs(clock);
+            }
+        }
+        ourModel.updatePosition();
+        double frameMs = elapsedMs(frameStart);
+        totalMs += frameMs;
+        if (timingsPath)
+            timings << frame << "," << forcesMs << "," << integrateMs << "," << selfCollisionMs << "," << frameMs << "\n";
+    }
+
+    cout << steps << " frames of " << substeps << " steps in " << totalMs << " ms, " << (steps > 0 ? totalMs / steps : 0.0) << " ms/frame on "
+        << ThreadPool::Get().Size() << " threads" << endl;
+    if (outPath)
+    {
+        if (!writeObj(ourModel, outPath))
+        {
+            cerr << "cannot write " << outPath << endl;
+            return 1;
+        }
+        cout << "wrote " << outPath << endl;
+    }
+    return 0;
+}
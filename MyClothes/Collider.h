@@ -0,0 +1,717 @@
+#ifndef COLLIDER_H
+#define COLLIDER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Vertex.h"
+#include "SignedDistanceField.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// particles are tested in blocks of this size: the block is gathered once into SoA scratch arrays,
+// culled against every collider's bounds and then run through one tight loop per collider type.
+#define COLLIDER_BLOCK_SIZE 64
+// upper bound on conservative advancement steps of the swept test
+#define COLLIDER_MARCH_STEPS 32
+
+enum ColliderType {
+    COLLIDER_PLANE,
+    COLLIDER_SPHERE,
+    COLLIDER_CAPSULE,
+    COLLIDER_BOX,
+    COLLIDER_FIELD
+};
+
+// rigid placement of a collider's shape
+struct ColliderPose {
+    glm::vec3 position;
+    glm::quat rotation;
+};
+
+inline ColliderPose InterpolatePose(const ColliderPose& a, const ColliderPose& b, float t)
+{
+    ColliderPose pose = { a.position + t * (b.position - a.position), glm::normalize(glm::slerp(a.rotation, b.rotation, t)) };
+    return pose;
+}
+
+struct ColliderKeyframe {
+    float time;
+    ColliderPose pose;
+};
+
+struct Collider {
+    ColliderType type;
+    bool enabled;
+    // plane: point on the plane, sphere/box: centre, capsule: first end point
+    glm::vec3 center;
+    // plane: unit normal, capsule: second end point
+    glm::vec3 axis;
+    // box: local axes as columns
+    glm::mat3 rotation;
+    glm::vec3 halfExtents;
+    float radius;
+    // field: baked signed distance field of a mesh
+    const SignedDistanceField* field;
+    float friction;
+    float restitution;
+    // motion of the surface itself, seen by the friction solve: velocity + angularVelocity x (p - center)
+    glm::vec3 velocity;
+    glm::vec3 angularVelocity;
+    // world space bounds used by the per block cull (not used by planes)
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    // number of particles pushed out during the last Resolve
+    int contacts;
+
+    // the shape as authored, in the collider's own frame; center, axis and rotation above are it placed at a pose
+    glm::vec3 localCenter;
+    glm::vec3 localAxis;
+    glm::mat3 localRotation;
+    // pose at the start and end of the frame, set once per frame by SetPose or the keyframes
+    ColliderPose previousPose;
+    ColliderPose pose;
+    vector<ColliderKeyframe> keyframes;
+    // the part of the frame covered by the current substep, and the bounds swept over it
+    ColliderPose sweepStart;
+    ColliderPose sweepEnd;
+    bool sweeping;
+    glm::vec3 sweepMin;
+    glm::vec3 sweepMax;
+    // rigid motion of the whole collider over the frame, about the pose position
+    glm::vec3 motionVelocity;
+    glm::vec3 motionAngularVelocity;
+};
+
+inline glm::vec3 SurfaceVelocity(const Collider& c, const glm::vec3& p)
+{
+    return c.velocity + glm::cross(c.angularVelocity, p - c.center)
+        + c.motionVelocity + glm::cross(c.motionAngularVelocity, p - c.sweepEnd.position);
+}
+
+// a particle touching a collider; the velocity response is left to ContactCache
+struct Contact {
+    int particle;
+    int collider;
+    glm::vec3 normal;
+    float gap;                  // distance outside the shell, 0 when touching; only a margin contact has one
+    float normalImpulse;        // accumulated velocity change along normal, >= 0
+    glm::vec3 tangentImpulse;   // accumulated friction velocity change, in the contact plane
+};
+
+class ColliderSet {
+public:
+    vector<Collider> colliders;
+    float thickness = 0.02f;
+    // particles within this distance outside the shell still count as touching, so a resting contact
+    // does not flicker in and out of the cache from one step to the next
+    float contactMargin = 0.01f;
+
+    int AddPlane(glm::vec3 point, glm::vec3 normal, float friction = 0.3f, float restitution = 0.2f)
+    {
+        Collider c = makeCollider(COLLIDER_PLANE, friction, restitution);
+        c.center = point;
+        c.axis = glm::normalize(normal);
+        return add(c);
+    }
+
+    int AddSphere(glm::vec3 center, float radius, float friction = 0.3f, float restitution = 0.2f)
+    {
+        Collider c = makeCollider(COLLIDER_SPHERE, friction, restitution);
+        c.center = center;
+        c.radius = radius;
+        return add(c);
+    }
+
+    int AddCapsule(glm::vec3 a, glm::vec3 b, float radius, float friction = 0.3f, float restitution = 0.2f)
+    {
+        Collider c = makeCollider(COLLIDER_CAPSULE, friction, restitution);
+        c.center = a;
+        c.axis = b;
+        c.radius = radius;
+        return add(c);
+    }
+
+    int AddBox(glm::vec3 center, glm::vec3 halfExtents, glm::mat3 rotation = glm::mat3(1.0f), float friction = 0.3f, float restitution = 0.2f)
+    {
+        Collider c = makeCollider(COLLIDER_BOX, friction, restitution);
+        c.center = center;
+        c.halfExtents = halfExtents;
+        c.rotation = rotation;
+        return add(c);
+    }
+
+    int AddField(const SignedDistanceField* field, float friction = 0.3f, float restitution = 0.2f)
+    {
+        Collider c = makeCollider(COLLIDER_FIELD, friction, restitution);
+        c.field = field;
+        return add(c);
+    }
+
+    // keyframes are poses of the authored shape, looped over the time of the last one
+    void AddKeyframe(int index, float time, glm::vec3 position, glm::quat rotation = glm::quat(1, 0, 0, 0))
+    {
+        ColliderKeyframe keyframe = { time, { position, rotation } };
+        vector<ColliderKeyframe>& keyframes = colliders[index].keyframes;
+        keyframes.insert(upper_bound(keyframes.begin(), keyframes.end(), keyframe,
+            [](const ColliderKeyframe& a, const ColliderKeyframe& b) { return a.time < b.time; }), keyframe);
+    }
+
+    // where a transform driven collider is at the end of the coming frame of length frameTime
+    void SetPose(int index, glm::vec3 position, glm::quat rotation, float frameTime)
+    {
+        Collider& c = colliders[index];
+        c.previousPose = c.pose;
+        c.pose.position = position;
+        c.pose.rotation = rotation;
+
+        c.motionVelocity = glm::vec3(0);
+        c.motionAngularVelocity = glm::vec3(0);
+        if (frameTime <= 0) return;
+        c.motionVelocity = (c.pose.position - c.previousPose.position) / frameTime;
+        // angular velocity from the relative rotation, taking the short way round
+        glm::quat delta = c.pose.rotation * glm::conjugate(c.previousPose.rotation);
+        if (delta.w < 0) delta = glm::quat(-delta.w, -delta.x, -delta.y, -delta.z);
+        glm::vec3 axis(delta.x, delta.y, delta.z);
+        float sinHalf = glm::length(axis);
+        if (sinHalf > 1e-6f)
+            c.motionAngularVelocity = axis / sinHalf * (2 * atan2f(sinHalf, delta.w) / frameTime);
+    }
+
+    // evaluates every keyframed collider once per frame; substeps then only interpolate
+    void Animate(float time, float frameTime)
+    {
+        for (int i = 0; i < colliders.size(); i++)
+        {
+            const vector<ColliderKeyframe>& keyframes = colliders[i].keyframes;
+            if (keyframes.empty()) continue;
+
+            float length = keyframes.back().time;
+            float t = length > 0 ? fmodf(time, length) : 0;
+            if (t < 0) t += length;
+            int k = 0;
+            while (k + 1 < keyframes.size() && keyframes[k + 1].time <= t) k++;
+            ColliderPose pose = keyframes[k].pose;
+            if (k + 1 < keyframes.size())
+            {
+                float span = keyframes[k + 1].time - keyframes[k].time;
+                pose = InterpolatePose(keyframes[k].pose, keyframes[k + 1].pose, span > 0 ? (t - keyframes[k].time) / span : 0);
+            }
+            SetPose(i, pose.position, pose.rotation, frameTime);
+        }
+    }
+
+    // places every collider for the substep covering [from, to] of the frame: the discrete test sees it at
+    // `to`, the swept test follows it from `from`
+    void Interpolate(float from, float to)
+    {
+        for (int i = 0; i < colliders.size(); i++)
+        {
+            Collider& c = colliders[i];
+            c.sweepStart = InterpolatePose(c.previousPose, c.pose, from);
+            c.sweepEnd = InterpolatePose(c.previousPose, c.pose, to);
+            c.sweeping = c.sweepStart.position != c.sweepEnd.position || glm::dot(c.sweepStart.rotation, c.sweepEnd.rotation) < 1 - 1e-7f;
+
+            place(c, c.sweepStart);
+            UpdateBounds(i);
+            c.sweepMin = c.boundsMin;
+            c.sweepMax = c.boundsMax;
+            place(c, c.sweepEnd);
+            UpdateBounds(i);
+            c.sweepMin = glm::min(c.sweepMin, c.boundsMin);
+            c.sweepMax = glm::max(c.sweepMax, c.boundsMax);
+        }
+    }
+
+    // call after moving or resizing a collider so the block cull sees the new bounds
+    void UpdateBounds(int index)
+    {
+        Collider& c = colliders[index];
+        glm::vec3 extent;
+        switch (c.type)
+        {
+        case COLLIDER_SPHERE:
+            c.boundsMin = c.center - glm::vec3(c.radius);
+            c.boundsMax = c.center + glm::vec3(c.radius);
+            break;
+        case COLLIDER_CAPSULE:
+            c.boundsMin = glm::min(c.center, c.axis) - glm::vec3(c.radius);
+            c.boundsMax = glm::max(c.center, c.axis) + glm::vec3(c.radius);
+            break;
+        case COLLIDER_BOX:
+            // extent of an oriented box along each world axis
+            extent = glm::abs(c.rotation[0]) * c.halfExtents.x + glm::abs(c.rotation[1]) * c.halfExtents.y + glm::abs(c.rotation[2]) * c.halfExtents.z;
+            c.boundsMin = c.center - extent;
+            c.boundsMax = c.center + extent;
+            break;
+        case COLLIDER_FIELD:
+            // the baked bounds carried along by the pose
+            extent = glm::abs(c.rotation[0]) * (0.5f * (c.field->boundsMax.x - c.field->boundsMin.x))
+                + glm::abs(c.rotation[1]) * (0.5f * (c.field->boundsMax.y - c.field->boundsMin.y))
+                + glm::abs(c.rotation[2]) * (0.5f * (c.field->boundsMax.z - c.field->boundsMin.z));
+            c.boundsMin = c.center + c.rotation * (0.5f * (c.field->boundsMin + c.field->boundsMax)) - extent;
+            c.boundsMax = c.center + c.rotation * (0.5f * (c.field->boundsMin + c.field->boundsMax)) + extent;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // one fused pass over all particles: every collider is tested against a block while its positions are hot.
+    // Penetrating particles are pushed out and appended to found, the velocities are left to the caller.
+    void Resolve(vector<Vertex>& vertices, vector<Contact>& found)
+    {
+        Resolve(vertices, found, all());
+    }
+
+    // the same, limited to the colliders a broad phase paired with this cloth
+    void Resolve(vector<Vertex>& vertices, vector<Contact>& found, const vector<int>& candidates)
+    {
+        for (int n = 0; n < candidates.size(); n++)
+            colliders[candidates[n]].contacts = 0;
+        Resolve(vertices, found, candidates, 0, vertices.size());
+    }
+
+    // and to the particles [first, first + count) of one cloth in a pool shared by several; the contact
+    // counts of the colliders are not cleared, so they add up over the cloths of a step
+    void Resolve(vector<Vertex>& vertices, vector<Contact>& found, const vector<int>& candidates, int first, int count)
+    {
+        int end = first + count;
+        for (int start = first; start < end; start += COLLIDER_BLOCK_SIZE)
+        {
+            int count = min(end - start, COLLIDER_BLOCK_SIZE);
+            gatherBlock(vertices, start, count);
+
+            for (int n = 0; n < candidates.size(); n++)
+            {
+                int i = candidates[n];
+                Collider& c = colliders[i];
+                if (!c.enabled || cullBlock(c)) continue;
+
+                switch (c.type)
+                {
+                case COLLIDER_PLANE:   testPlane(c);   break;
+                case COLLIDER_SPHERE:  testSphere(c);  break;
+                case COLLIDER_CAPSULE: testCapsule(c); break;
+                case COLLIDER_BOX:     testBox(c);     break;
+                case COLLIDER_FIELD:   testField(c);   break;
+                }
+                respond(i, vertices, start, found);
+            }
+        }
+    }
+
+    // Swept test for particles that moved further than thickness relative to a collider this step, so fast
+    // cloth cannot jump through a thin collider, nor a fast collider through the cloth, between two discrete
+    // tests. The motion is taken in the collider's own frame, from its pose at the start of the substep to its
+    // pose at the end, where the shape stands still. Every lane then marches along it by conservative
+    // advancement: the distance to the collider bounds how far it can move without touching it, so the same
+    // branch free kernels as Resolve are reused on the marched points. A lane that comes within thickness
+    // stops at the first contact and gets the usual response there.
+    void ResolveContinuous(vector<Vertex>& vertices)
+    {
+        ResolveContinuous(vertices, all());
+    }
+
+    void ResolveContinuous(vector<Vertex>& vertices, const vector<int>& candidates)
+    {
+        ResolveContinuous(vertices, candidates, 0, vertices.size());
+    }
+
+    // limited to the particles [first, first + count) of one cloth in a shared pool
+    void ResolveContinuous(vector<Vertex>& vertices, const vector<int>& candidates, int first, int count)
+    {
+        for (int n = 0; n < candidates.size(); n++)
+        {
+            Collider& c = colliders[candidates[n]];
+            if (!c.enabled) continue;
+
+            // a moving collider is tested at rest in its own frame
+            Collider shape = c;
+            glm::mat3 startRotation, endRotation;
+            if (c.sweeping)
+            {
+                ColliderPose identity = { glm::vec3(0), glm::quat(1, 0, 0, 0) };
+                place(shape, identity);
+                startRotation = glm::mat3_cast(c.sweepStart.rotation);
+                endRotation = glm::mat3_cast(c.sweepEnd.rotation);
+            }
+
+            for (int start = first; start < first + count; start += COLLIDER_BLOCK_SIZE)
+            {
+                int end = min(first + count, start + COLLIDER_BLOCK_SIZE);
+                int lanes = 0;
+                blockMin = glm::vec3(INFINITY);
+                blockMax = glm::vec3(-INFINITY);
+                for (int v = start; v < end; v++)
+                {
+                    const Vertex& vertex = vertices[v];
+                    if (vertex.isFixed) continue;
+                    glm::vec3 from = vertex.oldPos, to = vertex.Position;
+                    if (c.sweeping)
+                    {
+                        from = glm::transpose(startRotation) * (from - c.sweepStart.position);
+                        to = glm::transpose(endRotation) * (to - c.sweepEnd.position);
+                    }
+                    if (glm::length(to - from) <= thickness) continue;
+                    blockMin = glm::min(blockMin, glm::min(vertex.oldPos, vertex.Position));
+                    blockMax = glm::max(blockMax, glm::max(vertex.oldPos, vertex.Position));
+                    lane[lanes] = v;
+                    laneFrom[lanes] = from;
+                    laneTo[lanes] = to;
+                    lanes++;
+                }
+                if (lanes == 0 || cullSwept(c)) continue;
+
+                for (int k = 0; k < lanes; k++)
+                {
+                    marchTime[k] = 0;
+                    marching[k] = 1;
+                }
+                blockCount = lanes;
+                for (int step = 0; step < COLLIDER_MARCH_STEPS; step++)
+                {
+                    int active = 0;
+                    for (int k = 0; k < lanes; k++)
+                    {
+                        glm::vec3 p = laneFrom[k] + marchTime[k] * (laneTo[k] - laneFrom[k]);
+                        px[k] = p.x;
+                        py[k] = p.y;
+                        pz[k] = p.z;
+                        active += marching[k];
+                    }
+                    if (active == 0) break;
+
+                    switch (shape.type)
+                    {
+                    case COLLIDER_PLANE:   testPlane(shape);   break;
+                    case COLLIDER_SPHERE:  testSphere(shape);  break;
+                    case COLLIDER_CAPSULE: testCapsule(shape); break;
+                    case COLLIDER_BOX:     testBox(shape);     break;
+                    case COLLIDER_FIELD:   testField(shape);   break;
+                    }
+
+                    for (int k = 0; k < lanes; k++)
+                    {
+                        if (!marching[k]) continue;
+                        if (phi[k] < thickness)
+                        {
+                            // first contact: stop here, outside the shell, and drop the rest of the motion
+                            marching[k] = 0;
+                            if (marchTime[k] == 0) continue;   // already touching at the start, left to Resolve
+                            glm::vec3 normal(nx[k], ny[k], nz[k]);
+                            glm::vec3 p = glm::vec3(px[k], py[k], pz[k]) + (thickness - phi[k]) * normal;
+                            if (c.sweeping)
+                            {
+                                // the contact rides with the collider to its pose at the end of the substep
+                                p = c.sweepEnd.position + endRotation * p;
+                                normal = endRotation * normal;
+                            }
+                            Vertex& vertex = vertices[lane[k]];
+                            vertex.Position = p;
+                            respondVelocity(c, vertex, normal);
+                            c.contacts++;
+                            continue;
+                        }
+                        // keeping half the shell in hand means the march never steps through the surface
+                        float length = glm::length(laneTo[k] - laneFrom[k]);
+                        marchTime[k] += (phi[k] - 0.5f * thickness) / length;
+                        if (marchTime[k] >= 1) marching[k] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    // SoA scratch for the current block
+    int blockCount;
+    float px[COLLIDER_BLOCK_SIZE], py[COLLIDER_BLOCK_SIZE], pz[COLLIDER_BLOCK_SIZE];
+    float phi[COLLIDER_BLOCK_SIZE];
+    float nx[COLLIDER_BLOCK_SIZE], ny[COLLIDER_BLOCK_SIZE], nz[COLLIDER_BLOCK_SIZE];
+    glm::vec3 blockMin, blockMax;
+    // lanes of the swept test
+    int lane[COLLIDER_BLOCK_SIZE];
+    glm::vec3 laneFrom[COLLIDER_BLOCK_SIZE], laneTo[COLLIDER_BLOCK_SIZE];
+    float marchTime[COLLIDER_BLOCK_SIZE];
+    char marching[COLLIDER_BLOCK_SIZE];
+
+    Collider makeCollider(ColliderType type, float friction, float restitution)
+    {
+        Collider c;
+        c.type = type;
+        c.enabled = true;
+        c.center = glm::vec3(0);
+        c.axis = glm::vec3(0, 1, 0);
+        c.rotation = glm::mat3(1.0f);
+        c.halfExtents = glm::vec3(0);
+        c.radius = 0;
+        c.field = nullptr;
+        c.friction = friction;
+        c.restitution = restitution;
+        c.velocity = glm::vec3(0);
+        c.angularVelocity = glm::vec3(0);
+        c.boundsMin = glm::vec3(0);
+        c.boundsMax = glm::vec3(0);
+        c.contacts = 0;
+        ColliderPose identity = { glm::vec3(0), glm::quat(1, 0, 0, 0) };
+        c.previousPose = c.pose = c.sweepStart = c.sweepEnd = identity;
+        c.sweeping = false;
+        c.motionVelocity = glm::vec3(0);
+        c.motionAngularVelocity = glm::vec3(0);
+        return c;
+    }
+
+    // the shape as given to Add* becomes the local shape, placed at the identity pose
+    int add(Collider c)
+    {
+        c.localCenter = c.center;
+        c.localAxis = c.axis;
+        c.localRotation = c.rotation;
+        colliders.push_back(c);
+        UpdateBounds(colliders.size() - 1);
+        colliders.back().sweepMin = colliders.back().boundsMin;
+        colliders.back().sweepMax = colliders.back().boundsMax;
+        return colliders.size() - 1;
+    }
+
+    vector<int> all() const
+    {
+        vector<int> indices(colliders.size());
+        for (int i = 0; i < indices.size(); i++)
+            indices[i] = i;
+        return indices;
+    }
+
+    void place(Collider& c, const ColliderPose& pose) const
+    {
+        glm::mat3 R = glm::mat3_cast(pose.rotation);
+        c.center = pose.position + R * c.localCenter;
+        switch (c.type)
+        {
+        case COLLIDER_PLANE:
+            c.axis = R * c.localAxis;
+            break;
+        case COLLIDER_CAPSULE:
+            c.axis = pose.position + R * c.localAxis;
+            break;
+        default:
+            c.rotation = R * c.localRotation;
+            break;
+        }
+    }
+
+    void gatherBlock(const vector<Vertex>& vertices, int start, int count)
+    {
+        blockCount = count;
+        blockMin = glm::vec3(INFINITY);
+        blockMax = glm::vec3(-INFINITY);
+        for (int k = 0; k < count; k++)
+        {
+            const glm::vec3& p = vertices[start + k].Position;
+            px[k] = p.x;
+            py[k] = p.y;
+            pz[k] = p.z;
+            blockMin = glm::min(blockMin, p);
+            blockMax = glm::max(blockMax, p);
+        }
+    }
+
+    // true when no particle of the block can be within thickness (plus the contact margin) of the collider
+    bool cullBlock(const Collider& c) const
+    {
+        float reach = thickness + contactMargin;
+        if (c.type == COLLIDER_PLANE)
+        {
+            // corner of the block box that lies deepest along the plane normal
+            glm::vec3 corner(c.axis.x > 0 ? blockMin.x : blockMax.x,
+                             c.axis.y > 0 ? blockMin.y : blockMax.y,
+                             c.axis.z > 0 ? blockMin.z : blockMax.z);
+            return glm::dot(corner - c.center, c.axis) > reach;
+        }
+        glm::vec3 lo = c.boundsMin - glm::vec3(reach);
+        glm::vec3 hi = c.boundsMax + glm::vec3(reach);
+        return blockMax.x < lo.x || blockMin.x > hi.x
+            || blockMax.y < lo.y || blockMin.y > hi.y
+            || blockMax.z < lo.z || blockMin.z > hi.z;
+    }
+
+    // cull of the swept test: block bounds are those of the world space paths, the collider's cover its motion
+    bool cullSwept(const Collider& c) const
+    {
+        if (!c.sweeping) return cullBlock(c);
+        if (c.type == COLLIDER_PLANE) return false;
+        glm::vec3 lo = c.sweepMin - glm::vec3(thickness);
+        glm::vec3 hi = c.sweepMax + glm::vec3(thickness);
+        return blockMax.x < lo.x || blockMin.x > hi.x
+            || blockMax.y < lo.y || blockMin.y > hi.y
+            || blockMax.z < lo.z || blockMin.z > hi.z;
+    }
+
+    // the test kernels only fill phi (signed distance) and n (outward normal) for every lane,
+    // without branches, so they vectorise; the response loop below handles the few hits.
+    void testPlane(const Collider& c)
+    {
+        for (int k = 0; k < blockCount; k++)
+        {
+            phi[k] = (px[k] - c.center.x) * c.axis.x + (py[k] - c.center.y) * c.axis.y + (pz[k] - c.center.z) * c.axis.z;
+            nx[k] = c.axis.x;
+            ny[k] = c.axis.y;
+            nz[k] = c.axis.z;
+        }
+    }
+
+    void testSphere(const Collider& c)
+    {
+        for (int k = 0; k < blockCount; k++)
+        {
+            float dx = px[k] - c.center.x;
+            float dy = py[k] - c.center.y;
+            float dz = pz[k] - c.center.z;
+            float len = sqrtf(dx * dx + dy * dy + dz * dz);
+            float inv = 1.0f / max(len, 1e-6f);
+            phi[k] = len - c.radius;
+            nx[k] = dx * inv;
+            ny[k] = dy * inv;
+            nz[k] = dz * inv;
+        }
+    }
+
+    void testCapsule(const Collider& c)
+    {
+        glm::vec3 ab = c.axis - c.center;
+        float invLen2 = 1.0f / max(glm::dot(ab, ab), 1e-12f);
+        for (int k = 0; k < blockCount; k++)
+        {
+            float ax = px[k] - c.center.x;
+            float ay = py[k] - c.center.y;
+            float az = pz[k] - c.center.z;
+            float t = (ax * ab.x + ay * ab.y + az * ab.z) * invLen2;
+            t = min(max(t, 0.0f), 1.0f);
+            float dx = ax - t * ab.x;
+            float dy = ay - t * ab.y;
+            float dz = az - t * ab.z;
+            float len = sqrtf(dx * dx + dy * dy + dz * dz);
+            float inv = 1.0f / max(len, 1e-6f);
+            phi[k] = len - c.radius;
+            nx[k] = dx * inv;
+            ny[k] = dy * inv;
+            nz[k] = dz * inv;
+        }
+    }
+
+    void testBox(const Collider& c)
+    {
+        const glm::vec3& u = c.rotation[0];
+        const glm::vec3& v = c.rotation[1];
+        const glm::vec3& w = c.rotation[2];
+        for (int k = 0; k < blockCount; k++)
+        {
+            float dx = px[k] - c.center.x;
+            float dy = py[k] - c.center.y;
+            float dz = pz[k] - c.center.z;
+            // particle in box space
+            float lx = dx * u.x + dy * u.y + dz * u.z;
+            float ly = dx * v.x + dy * v.y + dz * v.z;
+            float lz = dx * w.x + dy * w.y + dz * w.z;
+            float qx = fabsf(lx) - c.halfExtents.x;
+            float qy = fabsf(ly) - c.halfExtents.y;
+            float qz = fabsf(lz) - c.halfExtents.z;
+            float sx = lx < 0 ? -1.0f : 1.0f;
+            float sy = ly < 0 ? -1.0f : 1.0f;
+            float sz = lz < 0 ? -1.0f : 1.0f;
+
+            // outside: gradient of the distance to the nearest surface point
+            float ox = max(qx, 0.0f), oy = max(qy, 0.0f), oz = max(qz, 0.0f);
+            float outside = sqrtf(ox * ox + oy * oy + oz * oz);
+            float inv = 1.0f / max(outside, 1e-6f);
+            // inside: face with the smallest penetration
+            float inside = min(max(qx, max(qy, qz)), 0.0f);
+            bool faceX = qx >= qy && qx >= qz;
+            bool faceY = !faceX && qy >= qz;
+            float fx = faceX ? sx : 0.0f;
+            float fy = faceY ? sy : 0.0f;
+            float fz = (!faceX && !faceY) ? sz : 0.0f;
+
+            bool out = outside > 0.0f;
+            float lnx = out ? sx * ox * inv : fx;
+            float lny = out ? sy * oy * inv : fy;
+            float lnz = out ? sz * oz * inv : fz;
+
+            phi[k] = outside + inside;
+            nx[k] = u.x * lnx + v.x * lny + w.x * lnz;
+            ny[k] = u.y * lnx + v.y * lny + w.y * lnz;
+            nz[k] = u.z * lnx + v.z * lny + w.z * lnz;
+        }
+    }
+
+    // one table read and eight samples per particle, independent of the triangle count of the baked mesh
+    void testField(const Collider& c)
+    {
+        for (int k = 0; k < blockCount; k++)
+        {
+            float distance;
+            glm::vec3 gradient;
+            // the field is baked in its own frame
+            glm::vec3 p = glm::transpose(c.rotation) * (glm::vec3(px[k], py[k], pz[k]) - c.center);
+            if (!c.field->Sample(p, distance, gradient))
+            {
+                // no contact, but a finite distance, so the swept test advances by a safe step instead of
+                // jumping over the whole band
+                phi[k] = c.field->DistanceBound(p);
+                nx[k] = ny[k] = nz[k] = 0;
+                continue;
+            }
+            gradient = c.rotation * gradient;
+            float inv = 1.0f / max(glm::length(gradient), 1e-6f);
+            phi[k] = distance;
+            nx[k] = gradient.x * inv;
+            ny[k] = gradient.y * inv;
+            nz[k] = gradient.z * inv;
+        }
+    }
+
+    // push particles closer than thickness back to the surface and record the contact, also for those in the margin
+    void respond(int index, vector<Vertex>& vertices, int start, vector<Contact>& found)
+    {
+        Collider& c = colliders[index];
+        for (int k = 0; k < blockCount; k++)
+        {
+            if (phi[k] >= thickness + contactMargin) continue;
+
+            Vertex& vertex = vertices[start + k];
+            if (vertex.isFixed) continue;
+
+            glm::vec3 normal(nx[k], ny[k], nz[k]);
+            glm::vec3 correction = max(thickness - phi[k], 0.0f) * normal;
+            vertex.Position += correction;
+            vertex.oldPos += correction;
+            px[k] = vertex.Position.x;
+            py[k] = vertex.Position.y;
+            pz[k] = vertex.Position.z;
+
+            Contact contact = { start + k, index, normal, max(phi[k] - thickness, 0.0f), 0, glm::vec3(0) };
+            found.push_back(contact);
+            c.contacts++;
+        }
+    }
+
+    // one shot response of a swept impact: reflect the normal velocity and damp the tangential one
+    void respondVelocity(const Collider& c, Vertex& vertex, const glm::vec3& normal)
+    {
+        glm::vec3 surface = SurfaceVelocity(c, vertex.Position);
+        glm::vec3 relative = vertex.velocity - surface;
+        float vn = glm::dot(relative, normal);
+        if (vn >= 0) return;
+        glm::vec3 Vn = vn * normal;
+        glm::vec3 Vt = relative - Vn;
+        float vtLength = glm::length(Vt);
+        float a = vtLength > 0 ? max(1.0f - c.friction * (1.0f + c.restitution) * fabsf(vn) / vtLength, 0.0f) : 0.0f;
+        vertex.velocity = surface - c.restitution * Vn + a * Vt;
+    }
+};
+#endif
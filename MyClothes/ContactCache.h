@@ -0,0 +1,117 @@
+#ifndef CONTACT_CACHE_H
+#define CONTACT_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Collider.h"
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// Particle-collider contacts kept from one step to the next. Each step the new contacts are matched to
+// last step's by (particle, collider) and start from the impulses they ended with, then a few sequential
+// impulse iterations solve the normal (non penetration plus restitution) and Coulomb friction constraints.
+// A contact still separated by a gap, inside the contact margin, only keeps the particle from closing more
+// than that gap within the step; it is neither bounced nor pushed.
+// A resting or sticking contact already starts at its converged impulse, so a couple of iterations hold it.
+class ContactCache
+{
+public:
+    vector<Contact> contacts;
+    int iterations = 4;
+    bool warmStart = true;
+    int matched = 0;
+
+    // call before the collider pass fills contacts
+    void Begin()
+    {
+        previous.swap(contacts);
+        contacts.clear();
+    }
+
+    void Solve(vector<Vertex>& vertices, const vector<Collider>& colliders, float etha)
+    {
+        sort(contacts.begin(), contacts.end(), [](const Contact& a, const Contact& b) { return key(a) < key(b); });
+
+        // carry over last step's impulses, re-expressed in the new contact frame
+        matched = 0;
+        int j = 0;
+        for (int i = 0; i < contacts.size(); i++)
+        {
+            Contact& contact = contacts[i];
+            while (j < previous.size() && key(previous[j]) < key(contact)) j++;
+            if (!warmStart || j == previous.size() || key(previous[j]) != key(contact)) continue;
+
+            glm::vec3 impulse = previous[j].normalImpulse * previous[j].normal + previous[j].tangentImpulse;
+            float normalPart = glm::dot(impulse, contact.normal);
+            contact.normalImpulse = max(normalPart, 0.0f);
+            contact.tangentImpulse = impulse - normalPart * contact.normal;
+            matched++;
+        }
+
+        // restitution targets come from the approach speed before any impulse is applied; a margin contact
+        // may still approach at gap / etha
+        target.resize(contacts.size());
+        for (int i = 0; i < contacts.size(); i++)
+        {
+            const Contact& contact = contacts[i];
+            if (contact.gap > 0)
+            {
+                target[i] = -contact.gap / etha;
+                continue;
+            }
+            const Collider& c = colliders[contact.collider];
+            const Vertex& vertex = vertices[contact.particle];
+            float vn = glm::dot(vertex.velocity - SurfaceVelocity(c, vertex.Position), contact.normal);
+            target[i] = vn < 0 ? -c.restitution * vn : 0;
+        }
+
+        for (int i = 0; i < contacts.size(); i++)
+        {
+            const Contact& contact = contacts[i];
+            vertices[contact.particle].velocity += contact.normalImpulse * contact.normal + contact.tangentImpulse;
+        }
+
+        for (int iteration = 0; iteration < iterations; iteration++)
+        {
+            for (int i = 0; i < contacts.size(); i++)
+            {
+                Contact& contact = contacts[i];
+                const Collider& c = colliders[contact.collider];
+                Vertex& vertex = vertices[contact.particle];
+                glm::vec3 surface = SurfaceVelocity(c, vertex.Position);
+
+                // normal: clamp the accumulated impulse, not the increment, so it can also be taken back
+                float vn = glm::dot(vertex.velocity - surface, contact.normal);
+                float normalImpulse = max(contact.normalImpulse + target[i] - vn, 0.0f);
+                vertex.velocity += (normalImpulse - contact.normalImpulse) * contact.normal;
+                contact.normalImpulse = normalImpulse;
+
+                // friction: stop the tangential slip, limited to the Coulomb cone of the normal impulse
+                glm::vec3 relative = vertex.velocity - surface;
+                glm::vec3 slip = relative - glm::dot(relative, contact.normal) * contact.normal;
+                glm::vec3 tangentImpulse = contact.tangentImpulse - slip;
+                float limit = c.friction * contact.normalImpulse;
+                float length = glm::length(tangentImpulse);
+                if (length > limit)
+                    tangentImpulse *= limit / length;
+                vertex.velocity += tangentImpulse - contact.tangentImpulse;
+                contact.tangentImpulse = tangentImpulse;
+            }
+        }
+    }
+
+private:
+    vector<Contact> previous;
+    vector<float> target;
+
+    static uint64_t key(const Contact& contact)
+    {
+        return ((uint64_t)contact.particle << 32) | (uint32_t)contact.collider;
+    }
+};
+#endif
@@ -0,0 +1,76 @@
+#ifndef EMBEDDING_H
+#define EMBEDDING_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "BVH.h"
+#include "CCD.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <cmath>
+using namespace std;
+
+// where a fine vertex sits on the coarse surface
+struct EmbeddingWeight {
+    int triangle;           // coarse triangle
+    glm::vec3 weights;      // barycentric weights of its three vertices
+    float offset;           // distance along the interpolated coarse normal
+};
+
+// A fine render mesh carried by a coarse simulated one. Every fine vertex is bound once, at rest, to the
+// closest point of the coarse surface (found with the cloth BVH) plus its height above it; after each step
+// its position is rebuilt from the same weights and the smooth coarse normals, so the physics cost only
+// depends on the coarse resolution. Those normals are the ones the coarse vertices carry, which the model
+// recomputes once per frame anyway; they must be current at Bind and at every Update.
+class EmbeddedMesh
+{
+public:
+    vector<EmbeddingWeight> bindings;
+
+    void Bind(const vector<Vertex>& coarse, const vector<unsigned int>& indices, const TriangleBVH& bvh, const vector<Vertex>& fine)
+    {
+        bindings.resize(fine.size());
+        ParallelFor(0, fine.size(), [&](int i)
+            {
+                EmbeddingWeight& binding = bindings[i];
+                glm::vec3 closest;
+                binding.triangle = bvh.Closest(coarse, fine[i].Position, closest);
+                if (binding.triangle < 0)
+                {
+                    binding.weights = glm::vec3(0);
+                    binding.offset = 0;
+                    return;
+                }
+                const unsigned int* tri = &indices[3 * binding.triangle];
+                binding.weights = Barycentric(closest, coarse[tri[0]].Position, coarse[tri[1]].Position, coarse[tri[2]].Position);
+                if (binding.weights.x < -0.5f) binding.weights = glm::vec3(1.0f / 3);   // degenerate triangle
+                binding.offset = glm::dot(fine[i].Position - closest, interpolatedNormal(coarse, tri, binding.weights));
+            }, 256);
+    }
+
+    // rebuilds the fine positions and normals from the current coarse vertices
+    void Update(const vector<Vertex>& coarse, const vector<unsigned int>& indices, vector<Vertex>& fine)
+    {
+        ParallelFor(0, fine.size(), [&](int i)
+            {
+                const EmbeddingWeight& binding = bindings[i];
+                if (binding.triangle < 0) return;
+                const unsigned int* tri = &indices[3 * binding.triangle];
+                glm::vec3 normal = interpolatedNormal(coarse, tri, binding.weights);
+                fine[i].Position = binding.weights.x * coarse[tri[0]].Position + binding.weights.y * coarse[tri[1]].Position
+                    + binding.weights.z * coarse[tri[2]].Position + binding.offset * normal;
+                fine[i].Normal = normal;
+            }, 1024);
+    }
+
+private:
+    static glm::vec3 interpolatedNormal(const vector<Vertex>& coarse, const unsigned int* tri, const glm::vec3& weights)
+    {
+        glm::vec3 n = weights.x * coarse[tri[0]].Normal + weights.y * coarse[tri[1]].Normal + weights.z * coarse[tri[2]].Normal;
+        float length = glm::length(n);
+        return length > 0 ? n / length : glm::vec3(0, 1, 0);
+    }
+};
+#endif
@@ -0,0 +1,52 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+// Camera and light state shared by every program through the "Frame" uniform block. The layout is std140, so
+// the three component values are stored as vec4 and each shader only reads their xyz.
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 viewPos;
+    glm::vec4 lightDirection;
+    glm::vec4 lightAmbient;
+    glm::vec4 lightDiffuse;
+    glm::vec4 lightSpecular;
+};
+
+// One uniform buffer, written once per frame and bound to a fixed binding point that each program's Frame
+// block is attached to, in place of setting the same values on every program.
+class FrameUniformBuffer
+{
+public:
+    static const unsigned int Binding = 0;
+
+    void Create()
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, Binding, UBO);
+    }
+
+    void Attach(const Shader& shader) const
+    {
+        shader.BindBlock("Frame", Binding);
+    }
+
+    void Update(const FrameUniforms& frame)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+private:
+    unsigned int UBO = 0;
+};
+#endif
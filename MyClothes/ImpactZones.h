@@ -0,0 +1,166 @@
+#ifndef IMPACT_ZONES_H
+#define IMPACT_ZONES_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "BVH.h"
+#include "CCD.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// Last resort for collisions the impulse passes of ContinuousCollision leave behind (Provot, "Collision and
+// self-collision handling in cloth model dedicated to design garments"; Bridson et al. 2002). Vertices of
+// the remaining impacts are grouped into zones with a union-find, and each zone moves rigidly over the step
+// with the momentum of its vertices, which cannot create new intersections inside it. The step is checked
+// again and zones that still collide merge with whatever they hit, until nothing is left. Only the
+// residual vertices are touched, so the rest of the cloth keeps its full step.
+class ImpactZones
+{
+public:
+    int maxIterations = 16;
+    int zoneCount = 0;
+    int largestZone = 0;
+    int iterations = 0;
+
+    void Resolve(vector<Vertex>& vertices, const vector<unsigned int>& indices, TriangleBVH& bvh, ContinuousCollision& ccd)
+    {
+        members.clear();
+        parent.clear();
+        local.clear();
+        iterations = 0;
+        zoneCount = 0;
+        largestZone = 0;
+        while (!ccd.impacts.empty() && iterations < maxIterations)
+        {
+            for (int i = 0; i < ccd.impacts.size(); i++)
+            {
+                const Impact& impact = ccd.impacts[i];
+                for (int k = 1; k < 4; k++)
+                    unite(find(slot(impact.vertex[0])), find(slot(impact.vertex[k])));
+            }
+            gatherZones();
+            for (int z = 0; z < zones.size(); z++)
+                rigidify(vertices, zones[z]);
+            iterations++;
+            ccd.Detect(vertices, indices, bvh);
+        }
+    }
+
+private:
+    vector<int> members;                // vertex of every union-find slot
+    vector<int> parent;
+    unordered_map<int, int> local;      // vertex -> slot
+    vector<vector<int>> zones;
+
+    int slot(int vertex)
+    {
+        auto found = local.insert(make_pair(vertex, (int)members.size()));
+        if (found.second)
+        {
+            members.push_back(vertex);
+            parent.push_back(members.size() - 1);
+        }
+        return found.first->second;
+    }
+
+    int find(int s)
+    {
+        while (parent[s] != s)
+        {
+            parent[s] = parent[parent[s]];
+            s = parent[s];
+        }
+        return s;
+    }
+
+    void unite(int a, int b)
+    {
+        if (a != b) parent[max(a, b)] = min(a, b);
+    }
+
+    void gatherZones()
+    {
+        vector<int> zoneOf(members.size(), -1);
+        zones.clear();
+        largestZone = 0;
+        for (int s = 0; s < members.size(); s++)
+        {
+            int root = find(s);
+            if (zoneOf[root] < 0)
+            {
+                zoneOf[root] = zones.size();
+                zones.push_back(vector<int>());
+            }
+            zones[zoneOf[root]].push_back(members[s]);
+            largestZone = max(largestZone, (int)zones[zoneOf[root]].size());
+        }
+        zoneCount = zones.size();
+    }
+
+    // rigid motion with the linear and angular momentum of the zone, applied to the step and to the velocities
+    void rigidify(vector<Vertex>& vertices, const vector<int>& zone)
+    {
+        float mass = 0;
+        glm::vec3 center(0), step(0), velocity(0);
+        bool pinned = false;
+        for (int i = 0; i < zone.size(); i++)
+        {
+            const Vertex& v = vertices[zone[i]];
+            pinned = pinned || v.isFixed;
+            mass += v.mass;
+            center += v.mass * v.oldPos;
+            step += v.mass * (v.Position - v.oldPos);
+            velocity += v.mass * v.velocity;
+        }
+        // a zone holding a fixed vertex cannot move at all
+        if (pinned)
+        {
+            for (int i = 0; i < zone.size(); i++)
+            {
+                Vertex& v = vertices[zone[i]];
+                if (v.isFixed) continue;
+                v.Position = v.oldPos;
+                v.velocity = glm::vec3(0);
+            }
+            return;
+        }
+        center /= mass;
+        step /= mass;
+        velocity /= mass;
+
+        glm::vec3 stepMomentum(0), velocityMomentum(0);
+        glm::mat3 inertia(0.0f);
+        for (int i = 0; i < zone.size(); i++)
+        {
+            const Vertex& v = vertices[zone[i]];
+            glm::vec3 r = v.oldPos - center;
+            stepMomentum += v.mass * glm::cross(r, v.Position - v.oldPos - step);
+            velocityMomentum += v.mass * glm::cross(r, v.velocity - velocity);
+            inertia = inertia + (glm::mat3(glm::dot(r, r)) + glm::outerProduct(r, -r)) * v.mass;
+        }
+        // a zone on a line has no inertia about it, the regularisation keeps the inverse finite
+        inertia = inertia + glm::mat3(1e-6f * mass);
+        glm::mat3 inverseInertia = glm::inverse(inertia);
+        glm::vec3 stepSpin = inverseInertia * stepMomentum;
+        glm::vec3 spin = inverseInertia * velocityMomentum;
+
+        // rotate the offsets by the spin over the step (Rodrigues), translate by the mean step
+        float angle = glm::length(stepSpin);
+        glm::vec3 axis = angle > 1e-9f ? stepSpin / angle : glm::vec3(0, 1, 0);
+        float c = cosf(angle), s = sinf(angle);
+        for (int i = 0; i < zone.size(); i++)
+        {
+            Vertex& v = vertices[zone[i]];
+            glm::vec3 r = v.oldPos - center;
+            glm::vec3 rotated = r * c + glm::cross(axis, r) * s + axis * glm::dot(axis, r) * (1 - c);
+            v.Position = center + step + rotated;
+            v.velocity = velocity + glm::cross(spin, r);
+        }
+    }
+};
+#endif
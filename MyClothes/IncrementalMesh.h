@@ -0,0 +1,247 @@
+#ifndef INCREMENTAL_MESH_H
+#define INCREMENTAL_MESH_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Spring.h"
+#include "Topology.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+struct MeshEdge {
+    int triangle[2];    // -1 when missing
+    int structural;     // spring index
+    int bending;        // bending spring across the edge, -1 on the boundary
+    bool torn;          // both triangles still share the end points but no longer hold each other
+};
+
+// A triangle mesh whose springs follow local edits of its topology (remeshing, tearing). Every edge is found
+// through a map keyed by its two end points and knows its triangles, its spring and the bending spring across
+// it, and every spring knows its edge, so an edit only visits the triangles, edges and springs it changes;
+// no vertexSort or CreateSpring pass is involved. Springs keep pointers into the vertex array, so it has to
+// have capacity for every particle the edits may add.
+class IncrementalMesh
+{
+public:
+    // takes over the springs of the mesh: they are rebuilt here, one per edge and one bending spring per
+    // interior edge, each indexed by its edge so later passes can edit them in place
+    void Setup(vector<Vertex>& vertices, const vector<unsigned int>& indices, vector<Spring>& springs, float structural, float bending, float damping)
+    {
+        structuralCoef = structural;
+        bendingCoef = bending;
+        dampCoef = damping;
+        rest.resize(vertices.size());
+        for (int i = 0; i < vertices.size(); i++)
+            rest[i] = vertices[i].oldPos;
+
+        edges.clear();
+        vertexTriangles.assign(vertices.size(), vector<int>());
+        for (int t = 0; t < indices.size() / 3; t++)
+            for (int k = 0; k < 3; k++)
+            {
+                vertexTriangles[indices[3 * t + k]].push_back(t);
+                attach(indices[3 * t + k], indices[3 * t + (k + 1) % 3], t);
+            }
+
+        springs.clear();
+        springKeys.clear();
+        springBending.clear();
+        for (auto it = edges.begin(); it != edges.end(); ++it)
+            it->second.structural = addSpring(vertices, springs, first(it->first), second(it->first), it->first, false);
+        for (auto it = edges.begin(); it != edges.end(); ++it)
+            updateBending(vertices, indices, springs, it->first);
+    }
+
+    // edge, bending and triangle pair lists for the rest of the pipeline, as vertexSort would give them
+    void Topology(const vector<unsigned int>& indices, vector<Edge>& edgeList, vector<Edge>& diagonals, vector<Neighbour>& neighbours) const
+    {
+        edgeList.clear();
+        diagonals.clear();
+        neighbours.clear();
+        for (auto it = edges.begin(); it != edges.end(); ++it)
+        {
+            Edge e = { first(it->first), second(it->first) };
+            edgeList.push_back(e);
+            const MeshEdge& edge = it->second;
+            if (edge.triangle[1] < 0 || edge.torn) continue;
+            Edge d = { opposite(indices, edge.triangle[0], e.firstVertex, e.secondVertex), opposite(indices, edge.triangle[1], e.firstVertex, e.secondVertex) };
+            Neighbour pair = { edge.triangle[0], edge.triangle[1] };
+            diagonals.push_back(d);
+            neighbours.push_back(pair);
+        }
+    }
+
+    const vector<glm::vec3>& RestPositions() const
+    {
+        return rest;
+    }
+
+    // for every vertex, the one it was before the last edit; an added vertex names the one it was made from
+    const vector<int>& VertexOrigins() const
+    {
+        return vertexOrigin;
+    }
+
+    // for every vertex, the one it was before the last edit, or -1 for a vertex the edit added
+    const vector<int>& VertexSources() const
+    {
+        return vertexSource;
+    }
+
+protected:
+    float structuralCoef = 0;
+    float bendingCoef = 0;
+    float dampCoef = 0;
+    vector<glm::vec3> rest;
+    unordered_map<uint64_t, MeshEdge> edges;
+    vector<vector<int>> vertexTriangles;
+    vector<uint64_t> springKeys;        // edge of every spring
+    vector<char> springBending;
+    vector<int> vertexOrigin;
+    vector<int> vertexSource;
+
+    // starts an edit of a mesh with n vertices, each of which is still itself
+    void beginEdit(int n)
+    {
+        vertexOrigin.resize(n);
+        vertexSource.resize(n);
+        for (int i = 0; i < n; i++)
+            vertexOrigin[i] = vertexSource[i] = i;
+    }
+
+    static uint64_t key(int a, int b)
+    {
+        if (a > b) swap(a, b);
+        return ((uint64_t)a << 32) | (uint32_t)b;
+    }
+
+    static int first(uint64_t k) { return (int)(k >> 32); }
+    static int second(uint64_t k) { return (int)(k & 0xffffffffu); }
+
+    static int opposite(const vector<unsigned int>& indices, int t, int a, int b)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int v = indices[3 * t + k];
+            if (v != a && v != b) return v;
+        }
+        return -1;
+    }
+
+    void attach(int a, int b, int t)
+    {
+        MeshEdge fresh = { { -1, -1 }, -1, -1, false };
+        MeshEdge& edge = edges.insert(make_pair(key(a, b), fresh)).first->second;
+        if (edge.triangle[0] < 0) edge.triangle[0] = t;
+        else edge.triangle[1] = t;
+    }
+
+    void replaceTriangle(uint64_t k, int from, int to)
+    {
+        auto it = edges.find(k);
+        if (it == edges.end()) return;
+        MeshEdge& edge = it->second;
+        if (edge.triangle[0] == from) edge.triangle[0] = to;
+        else if (edge.triangle[1] == from) edge.triangle[1] = to;
+    }
+
+    void dropTriangle(uint64_t k, int t)
+    {
+        auto it = edges.find(k);
+        if (it == edges.end()) return;
+        MeshEdge& edge = it->second;
+        if (edge.triangle[0] == t)
+        {
+            edge.triangle[0] = edge.triangle[1];
+            edge.triangle[1] = -1;
+        }
+        else if (edge.triangle[1] == t) edge.triangle[1] = -1;
+    }
+
+    static void eraseValue(vector<int>& list, int value)
+    {
+        auto it = find(list.begin(), list.end(), value);
+        if (it != list.end()) list.erase(it);
+    }
+
+    int addSpring(vector<Vertex>& vertices, vector<Spring>& springs, int p, int q, uint64_t edgeKey, bool bending)
+    {
+        springs.push_back(Spring(&vertices[p], &vertices[q], bending ? bendingCoef : structuralCoef, dampCoef));
+        springs.back().originLength = glm::length(rest[p] - rest[q]);
+        springKeys.push_back(edgeKey);
+        springBending.push_back(bending);
+        return springs.size() - 1;
+    }
+
+    void bindSpring(vector<Vertex>& vertices, vector<Spring>& springs, int s, int p, int q)
+    {
+        springs[s].node1 = &vertices[p];
+        springs[s].node2 = &vertices[q];
+        springs[s].originLength = glm::length(rest[p] - rest[q]);
+    }
+
+    // swap and pop, the spring moved into the hole is re-pointed to by its edge
+    void removeSpring(vector<Spring>& springs, int s)
+    {
+        int last = springs.size() - 1;
+        if (s != last)
+        {
+            springs[s] = springs[last];
+            springKeys[s] = springKeys[last];
+            springBending[s] = springBending[last];
+            auto it = edges.find(springKeys[s]);
+            if (it != edges.end())
+            {
+                if (springBending[s]) it->second.bending = s;
+                else it->second.structural = s;
+            }
+        }
+        springs.pop_back();
+        springKeys.pop_back();
+        springBending.pop_back();
+    }
+
+    // the bending spring across an edge joins the two opposite vertices; created, moved or dropped to match,
+    // a torn edge has none
+    void updateBending(vector<Vertex>& vertices, const vector<unsigned int>& indices, vector<Spring>& springs, uint64_t k)
+    {
+        auto it = edges.find(k);
+        if (it == edges.end()) return;
+        MeshEdge& edge = it->second;
+        if (edge.triangle[1] < 0 || edge.torn)
+        {
+            if (edge.bending >= 0)
+            {
+                int s = edge.bending;
+                edge.bending = -1;
+                removeSpring(springs, s);
+            }
+            return;
+        }
+        int c = opposite(indices, edge.triangle[0], first(k), second(k));
+        int d = opposite(indices, edge.triangle[1], first(k), second(k));
+        if (edge.bending >= 0) bindSpring(vertices, springs, edge.bending, c, d);
+        else edge.bending = addSpring(vertices, springs, c, d, k, true);
+    }
+
+    static void replaceVertex(vector<unsigned int>& indices, int t, int from, int to)
+    {
+        for (int k = 0; k < 3; k++)
+            if (indices[3 * t + k] == from) indices[3 * t + k] = to;
+    }
+
+    void removeStructural(vector<Spring>& springs, const MeshEdge& e)
+    {
+        // the higher index first, so removing it cannot move the other
+        int s0 = e.structural, s1 = e.bending;
+        if (s0 < s1) swap(s0, s1);
+        if (s0 >= 0) removeSpring(springs, s0);
+        if (s1 >= 0) removeSpring(springs, s1);
+    }
+};
+#endif
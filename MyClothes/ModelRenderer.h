@@ -0,0 +1,312 @@
+#ifndef MODEL_RENDERER_H
+#define MODEL_RENDERER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+#include "std_image.h"
+#include "shader.h"
+#include "RenderVertex.h"
+#include "model.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+
+// a texture of a mesh as drawn with one program: the unit it goes to and the sampler that reads it
+struct TextureBinding {
+    unsigned int unit;
+    unsigned int id;
+    int location;
+};
+
+// The GL side of one Mesh: its vertex array, the per frame stream of positions and packed normals, the static
+// attributes and the index buffer. It only ever reads vertex and index arrays handed to it, so they may come
+// from the simulated mesh itself or from a snapshot the simulation thread published. Every material range is
+// a draw of its own with its textures; the ranges keep their first triangles, the last one runs to the end
+// of whatever index count the topology has by now.
+class MeshRenderer {
+public:
+    unsigned int VAO = 0;
+
+    // materials as the mesh has them, with their texture ids loaded
+    void Setup(const vector<Vertex>& vertices, const vector<unsigned int>& indices, const vector<MaterialRange>& materials)
+    {
+        ranges.resize(materials.size());
+        for (int i = 0; i < materials.size(); i++)
+        {
+            ranges[i].firstIndex = 3 * materials[i].firstTriangle;
+            ranges[i].textures = materials[i].textures;
+            ranges[i].bindings.clear();
+        }
+        indexCount = indices.size();
+        // create buffers/arrays
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &staticVBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+        // load data into vertex buffers: the per frame stream of positions and packed normals
+        PackRenderVertices(vertices, stream);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, stream.size() * sizeof(RenderVertex), &stream[0], GL_DYNAMIC_DRAW);
+        bufferVertices = vertices.size();
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+        // set the vertex attribute pointers
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RenderVertex), (void*)offsetof(RenderVertex, Position));
+        // vertex normals, octahedral
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(RenderVertex), (void*)offsetof(RenderVertex, Normal));
+
+        // the rest from the static buffer.
+        // A great thing about structs is that their memory layout is sequential for all its items.
+        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
+        // again translates to 3/2 floats which translates to a byte array.
+        uploadStatic(vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, staticVBO);
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, Bitangent));
+        // ids
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(StaticVertex), (void*)offsetof(StaticVertex, m_BoneIDs));
+
+        // weights
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, m_Weights));
+        glBindVertexArray(0);
+    }
+
+    // render the mesh
+    void Draw(Shader& shader)
+    {
+        if (bindingProgram != shader.ID)
+        {
+            for (int r = 0; r < ranges.size(); r++)
+                resolveTextures(shader, ranges[r]);
+            bindingProgram = shader.ID;
+        }
+        glBindVertexArray(VAO);
+        for (int r = 0; r < ranges.size(); r++)
+        {
+            size_t first = min(ranges[r].firstIndex, indexCount);
+            size_t end = r + 1 < ranges.size() ? min(ranges[r + 1].firstIndex, indexCount) : indexCount;
+            if (end <= first) continue;
+            // bind appropriate textures
+            for (int i = 0; i < ranges[r].bindings.size(); i++)
+            {
+                const TextureBinding& binding = ranges[r].bindings[i];
+                glActiveTexture(GL_TEXTURE0 + binding.unit);
+                glUniform1i(binding.location, binding.unit);
+                glBindTexture(GL_TEXTURE_2D, binding.id);
+            }
+            // draw the range
+            glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(end - first), GL_UNSIGNED_INT, (void*)(first * sizeof(unsigned int)));
+        }
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // re-uploads the simulated positions and normals in their compact form into the existing vertex buffer,
+    // reallocating it (and the static attributes with it) when the count changed
+    void UpdateVertices(const vector<Vertex>& vertices)
+    {
+        PackRenderVertices(vertices, stream);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (vertices.size() != bufferVertices)
+        {
+            glBufferData(GL_ARRAY_BUFFER, stream.size() * sizeof(RenderVertex), &stream[0], GL_DYNAMIC_DRAW);
+            bufferVertices = vertices.size();
+            uploadStatic(vertices);
+        }
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, 0, stream.size() * sizeof(RenderVertex), &stream[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // re-uploads the triangle indices, e.g. after the vertices were renumbered, and so the static attributes too
+    void UpdateIndices(const vector<Vertex>& vertices, const vector<unsigned int>& indices)
+    {
+        indexCount = indices.size();
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        uploadStatic(vertices);
+    }
+
+private:
+    struct DrawRange {
+        size_t firstIndex;
+        vector<Texture> textures;
+        vector<TextureBinding> bindings;
+    };
+
+    // render data
+    unsigned int VBO = 0, EBO = 0;
+    unsigned int staticVBO = 0; // StaticVertex: the attributes that do not move
+    size_t bufferVertices = 0;  // vertices the VBO was allocated for
+    size_t indexCount = 0;
+    vector<DrawRange> ranges;
+    vector<RenderVertex> stream;
+    vector<StaticVertex> staticAttributes;
+    unsigned int bindingProgram = 0;    // the program the bindings were resolved for
+
+    // gives every texture of a range its unit and finds its sampler (texture_diffuseN and so on, N counting
+    // per type) in the program, once per program the mesh is drawn with rather than on every draw
+    void resolveTextures(const Shader& shader, DrawRange& range)
+    {
+        const vector<Texture>& textures = range.textures;
+        vector<TextureBinding>& textureBindings = range.bindings;
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        textureBindings.resize(textures.size());
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            // retrieve texture number (the N in diffuse_textureN)
+            string number;
+            const string& name = textures[i].type;
+            if (name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (name == "texture_specular")
+                number = std::to_string(specularNr++); // transfer unsigned int to string
+            else if (name == "texture_normal")
+                number = std::to_string(normalNr++); // transfer unsigned int to string
+            else if (name == "texture_height")
+                number = std::to_string(heightNr++); // transfer unsigned int to string
+
+            textureBindings[i].unit = i;
+            textureBindings[i].id = textures[i].id;
+            textureBindings[i].location = shader.Uniform(name + number);
+        }
+    }
+
+    void uploadStatic(const vector<Vertex>& vertices)
+    {
+        PackStaticVertices(vertices, staticAttributes);
+        glBindBuffer(GL_ARRAY_BUFFER, staticVBO);
+        glBufferData(GL_ARRAY_BUFFER, staticAttributes.size() * sizeof(StaticVertex), &staticAttributes[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+// Draws a Model: loads the textures its materials name and keeps a MeshRenderer per mesh. The model is only
+// read, on the thread that owns the GL context; with the simulation on a thread of its own the meshes are
+// updated from the published snapshots instead, through meshes[i] directly.
+class ModelRenderer {
+public:
+    vector<MeshRenderer> meshes;
+    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+
+    void Setup(const Model& model)
+    {
+        meshes.resize(model.meshes.size());
+        for (int i = 0; i < model.meshes.size(); i++)
+        {
+            const Mesh& mesh = model.meshes[i];
+            vector<MaterialRange> materials = mesh.materials;
+            for (int m = 0; m < materials.size(); m++)
+                for (int t = 0; t < materials[m].textures.size(); t++)
+                    materials[m].textures[t].id = loadTexture(materials[m].textures[t], model.directory);
+            meshes[i].Setup(mesh.vertices, mesh.indices, materials);
+        }
+        topology = model.topologyVersion;
+    }
+
+    // uploads the vertices of every mesh, and the indices too once the model's topology has changed
+    void Update(const Model& model)
+    {
+        bool changed = model.topologyVersion != topology;
+        for (int i = 0; i < meshes.size() && i < model.meshes.size(); i++)
+        {
+            if (changed) meshes[i].UpdateIndices(model.meshes[i].vertices, model.meshes[i].indices);
+            meshes[i].UpdateVertices(model.meshes[i].vertices);
+        }
+        topology = model.topologyVersion;
+    }
+
+    // draws the model, and thus all its meshes
+    void Draw(Shader& shader)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader);
+    }
+
+private:
+    int topology = 0;
+
+    unsigned int loadTexture(const Texture& texture, const string& directory)
+    {
+        // check if texture was loaded before and if so, skip loading a new texture
+        for (unsigned int j = 0; j < textures_loaded.size(); j++)
+            if (std::strcmp(textures_loaded[j].path.data(), texture.path.data()) == 0)
+                return textures_loaded[j].id;
+        Texture loaded = texture;
+        loaded.id = TextureFromFile(texture.path.c_str(), directory);
+        textures_loaded.push_back(loaded);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return loaded.id;
+    }
+};
+
+unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
+{
+    string filename = string(path);
+    filename = directory + '/' + filename;
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    int width, height, nrComponents;
+    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    if (data)
+    {
+        GLenum format;
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(data);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        stbi_image_free(data);
+    }
+
+    return textureID;
+}
+#endif
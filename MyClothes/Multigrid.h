@@ -0,0 +1,448 @@
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include <glm/glm.hpp>
+
+#include "Parallel.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// compressed sparse rows
+struct SparseMatrix {
+    int rows = 0;
+    int columns = 0;
+    vector<int> start;      // rows + 1 entries
+    vector<int> column;
+    vector<float> value;
+
+    // y = A x, one row per task
+    void Multiply(const vector<glm::vec3>& x, vector<glm::vec3>& y) const
+    {
+        y.resize(rows);
+        ParallelFor(0, rows, [&](int i)
+            {
+                glm::vec3 sum(0);
+                for (int k = start[i]; k < start[i + 1]; k++)
+                    sum += value[k] * x[column[k]];
+                y[i] = sum;
+            }, 1024);
+    }
+
+    SparseMatrix Transpose() const
+    {
+        SparseMatrix t;
+        t.rows = columns;
+        t.columns = rows;
+        t.start.assign(columns + 1, 0);
+        for (int k = 0; k < column.size(); k++)
+            t.start[column[k] + 1]++;
+        for (int c = 0; c < columns; c++)
+            t.start[c + 1] += t.start[c];
+        t.column.resize(column.size());
+        t.value.resize(value.size());
+        vector<int> fill(t.start.begin(), t.start.end() - 1);
+        for (int i = 0; i < rows; i++)
+            for (int k = start[i]; k < start[i + 1]; k++)
+            {
+                int slot = fill[column[k]]++;
+                t.column[slot] = i;
+                t.value[slot] = value[k];
+            }
+        return t;
+    }
+};
+
+// C = A B, row by row with a dense accumulator (Gustavson)
+inline SparseMatrix SparseProduct(const SparseMatrix& a, const SparseMatrix& b)
+{
+    SparseMatrix c;
+    c.rows = a.rows;
+    c.columns = b.columns;
+    c.start.assign(a.rows + 1, 0);
+    vector<float> accumulator(b.columns, 0.0f);
+    vector<int> marker(b.columns, -1);
+    vector<int> used;
+    for (int i = 0; i < a.rows; i++)
+    {
+        used.clear();
+        for (int ka = a.start[i]; ka < a.start[i + 1]; ka++)
+        {
+            int j = a.column[ka];
+            for (int kb = b.start[j]; kb < b.start[j + 1]; kb++)
+            {
+                int col = b.column[kb];
+                if (marker[col] != i)
+                {
+                    marker[col] = i;
+                    accumulator[col] = 0;
+                    used.push_back(col);
+                }
+                accumulator[col] += a.value[ka] * b.value[kb];
+            }
+        }
+        sort(used.begin(), used.end());
+        for (int k = 0; k < used.size(); k++)
+        {
+            c.column.push_back(used[k]);
+            c.value.push_back(accumulator[used[k]]);
+        }
+        c.start[i + 1] = c.column.size();
+    }
+    return c;
+}
+
+// Geometric multigrid over a hierarchy of decimated cloth meshes, for symmetric positive definite systems
+// with one scalar matrix shared by the x, y and z components. Each coarser mesh keeps a maximal independent
+// set of the vertices of the finer one and removes the rest, whose holes are closed by joining the kept
+// neighbours of each removed vertex (vertex decimation); a removed vertex is then interpolated from those
+// neighbours with inverse distance weights at rest, which is the prolongation P, and restriction is P^T.
+// The coarse matrices are the Galerkin products P^T A P rather than the springs rediscretised on every
+// mesh, so the coarse systems stay consistent with whatever the fine matrix holds (pins, step size). A
+// V-cycle smooths the fine error with damped Jacobi and removes the smooth, low frequency part (e.g. the sag
+// of the whole sheet) on the coarse meshes, where it is cheap; the smallest is solved directly. The
+// convergence per cycle is therefore close to independent of the resolution.
+//
+// After a local edit of the mesh the hierarchy is kept: UpdateFine swaps in the new fine matrix and gives
+// every fine vertex the interpolation row of the vertex it came from, and the coarse matrices, which still
+// hold the products of the old one, are recomputed by RefreshCoarse when the caller sees fit.
+class Multigrid
+{
+public:
+    int preSmooth = 2;
+    int postSmooth = 2;
+    float jacobiWeight = 0.66f;
+    int coarsestSize = 64;
+    int maxLevels = 16;
+    int maxDirectSize = 1024;   // a larger coarsest level (coarsening stalled) is smoothed instead
+    float maxChange = 0.25f;    // fraction of added and removed fine vertices UpdateFine still accepts
+
+    int LevelCount() const
+    {
+        return levels.size();
+    }
+
+    int LevelSize(int level) const
+    {
+        return levels[level].A.rows;
+    }
+
+    // A is the system on the mesh with the given rest positions and edges, one row per vertex
+    void Setup(const SparseMatrix& A, const vector<glm::vec3>& positions, const vector<pair<int, int>>& edges)
+    {
+        levels.clear();
+        levels.push_back(Level());
+        levels[0].A = A;
+        vector<glm::vec3> meshPositions = positions;
+        vector<pair<int, int>> meshEdges = edges;
+        while (levels.size() < maxLevels && levels.back().A.rows > coarsestSize)
+        {
+            Level& fine = levels.back();
+            SparseMatrix P = decimate(meshPositions, meshEdges);
+            if (P.columns >= fine.A.rows) break;   // no coarsening left
+            Level coarse;
+            fine.R = P.Transpose();
+            coarse.A = SparseProduct(fine.R, SparseProduct(fine.A, P));
+            fine.P = P;
+            levels.push_back(coarse);
+        }
+        for (int l = 0; l < levels.size(); l++)
+        {
+            Level& level = levels[l];
+            level.inverseDiagonal.resize(level.A.rows);
+            for (int i = 0; i < level.A.rows; i++)
+                level.inverseDiagonal[i] = 1.0f / diagonal(level.A, i);
+            level.x.resize(level.A.rows);
+            level.b.resize(level.A.rows);
+            level.r.resize(level.A.rows);
+        }
+        factorCoarsest();
+        builtP = levels[0].P;
+        builtRows = A.rows;
+        stale = false;
+    }
+
+    // replaces the fine matrix after an edit of the mesh; origin[i] is the vertex of the mesh given to Setup
+    // that fine vertex i came from. False when too much has changed since Setup, which is then due again.
+    bool UpdateFine(const SparseMatrix& A, const vector<int>& origin)
+    {
+        if (levels.empty()) return false;
+        vector<char> used(builtRows, 0);
+        int distinct = 0;
+        for (int i = 0; i < A.rows; i++)
+            if (!used[origin[i]]++) distinct++;
+        if ((A.rows - distinct) + (builtRows - distinct) > maxChange * builtRows) return false;
+
+        Level& fine = levels[0];
+        fine.A = A;
+        fine.inverseDiagonal.resize(A.rows);
+        for (int i = 0; i < A.rows; i++)
+            fine.inverseDiagonal[i] = 1.0f / diagonal(A, i);
+        fine.x.resize(A.rows);
+        fine.b.resize(A.rows);
+        fine.r.resize(A.rows);
+        if (levels.size() == 1)
+        {
+            factorCoarsest();
+            return true;
+        }
+        SparseMatrix& P = fine.P;
+        P.rows = A.rows;
+        P.start.assign(A.rows + 1, 0);
+        P.column.clear();
+        P.value.clear();
+        for (int i = 0; i < A.rows; i++)
+        {
+            int o = origin[i];
+            P.column.insert(P.column.end(), builtP.column.begin() + builtP.start[o], builtP.column.begin() + builtP.start[o + 1]);
+            P.value.insert(P.value.end(), builtP.value.begin() + builtP.start[o], builtP.value.begin() + builtP.start[o + 1]);
+            P.start[i + 1] = P.column.size();
+        }
+        fine.R = P.Transpose();
+        stale = true;
+        return true;
+    }
+
+    // true while the coarse matrices were not recomputed since UpdateFine
+    bool Stale() const
+    {
+        return stale;
+    }
+
+    // the Galerkin products of the coarse levels and the coarsest factor, from the current fine matrix
+    void RefreshCoarse()
+    {
+        for (int l = 0; l + 1 < levels.size(); l++)
+        {
+            Level& coarse = levels[l + 1];
+            coarse.A = SparseProduct(levels[l].R, SparseProduct(levels[l].A, levels[l].P));
+            for (int i = 0; i < coarse.A.rows; i++)
+                coarse.inverseDiagonal[i] = 1.0f / diagonal(coarse.A, i);
+        }
+        factorCoarsest();
+        stale = false;
+    }
+
+    // one V-cycle on A x = b, x holds the initial guess
+    void VCycle(vector<glm::vec3>& x, const vector<glm::vec3>& b)
+    {
+        if (levels.empty()) return;
+        levels[0].x.swap(x);
+        levels[0].b = b;
+        cycle(0);
+        levels[0].x.swap(x);
+    }
+
+    // norm of b - A x relative to the norm of b
+    float Residual(const vector<glm::vec3>& x, const vector<glm::vec3>& b)
+    {
+        const SparseMatrix& A = levels[0].A;
+        A.Multiply(x, levels[0].r);
+        double r = 0, n = 0;
+        for (int i = 0; i < A.rows; i++)
+        {
+            glm::vec3 d = b[i] - levels[0].r[i];
+            r += glm::dot(d, d);
+            n += glm::dot(b[i], b[i]);
+        }
+        return n > 0 ? (float)sqrt(r / n) : 0;
+    }
+
+private:
+    struct Level {
+        SparseMatrix A;
+        SparseMatrix P;     // to this level from the next coarser one
+        SparseMatrix R;     // P^T
+        vector<float> inverseDiagonal;
+        vector<glm::vec3> x, b, r;
+    };
+    vector<Level> levels;
+    vector<float> cholesky;     // dense factor of the coarsest matrix, row major lower triangle
+    SparseMatrix builtP;        // finest prolongation as Setup built it, one row per vertex of its mesh
+    int builtRows = 0;
+    bool stale = false;
+    vector<glm::vec3> scratch;
+
+    static float diagonal(const SparseMatrix& A, int i)
+    {
+        for (int k = A.start[i]; k < A.start[i + 1]; k++)
+            if (A.column[k] == i) return A.value[k];
+        return 1;
+    }
+
+    void cycle(int l)
+    {
+        Level& level = levels[l];
+        if (l == levels.size() - 1)
+        {
+            solveCoarsest(level.x, level.b);
+            return;
+        }
+        smooth(level, preSmooth);
+
+        // restrict the residual, solve for the coarse correction from zero, prolong it back
+        level.A.Multiply(level.x, level.r);
+        ParallelFor(0, level.A.rows, [&](int i) { level.r[i] = level.b[i] - level.r[i]; }, 4096);
+        Level& coarse = levels[l + 1];
+        level.R.Multiply(level.r, coarse.b);
+        fill(coarse.x.begin(), coarse.x.end(), glm::vec3(0));
+        cycle(l + 1);
+        level.P.Multiply(coarse.x, level.r);
+        ParallelFor(0, level.A.rows, [&](int i) { level.x[i] += level.r[i]; }, 4096);
+
+        smooth(level, postSmooth);
+    }
+
+    void smooth(Level& level, int sweeps)
+    {
+        const SparseMatrix& A = level.A;
+        for (int s = 0; s < sweeps; s++)
+        {
+            A.Multiply(level.x, level.r);
+            ParallelFor(0, A.rows, [&](int i) { level.x[i] += jacobiWeight * level.inverseDiagonal[i] * (level.b[i] - level.r[i]); }, 4096);
+        }
+    }
+
+    // Removes a maximal independent set's complement from the mesh, replacing positions and edges by those of
+    // the coarse mesh, and returns the prolongation to the given mesh from it. Vertices are visited in order,
+    // so on the generated grids the kept ones form a regular pattern.
+    static SparseMatrix decimate(vector<glm::vec3>& positions, vector<pair<int, int>>& edges)
+    {
+        int n = positions.size();
+        vector<int> start(n + 1, 0), neighbours(2 * edges.size());
+        for (int e = 0; e < edges.size(); e++)
+        {
+            start[edges[e].first + 1]++;
+            start[edges[e].second + 1]++;
+        }
+        for (int i = 0; i < n; i++)
+            start[i + 1] += start[i];
+        vector<int> fill(start.begin(), start.end() - 1);
+        for (int e = 0; e < edges.size(); e++)
+        {
+            neighbours[fill[edges[e].first]++] = edges[e].second;
+            neighbours[fill[edges[e].second]++] = edges[e].first;
+        }
+
+        vector<int> coarseIndex(n, -1);
+        vector<char> removed(n, 0);
+        int count = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (removed[i]) continue;
+            coarseIndex[i] = count++;
+            for (int k = start[i]; k < start[i + 1]; k++)
+                removed[neighbours[k]] = 1;
+        }
+
+        SparseMatrix P;
+        P.rows = n;
+        P.columns = count;
+        P.start.assign(n + 1, 0);
+        vector<glm::vec3> coarsePositions(count);
+        vector<pair<int, int>> coarseEdges;
+        vector<pair<int, float>> row;
+        for (int i = 0; i < n; i++)
+        {
+            row.clear();
+            if (coarseIndex[i] >= 0)
+            {
+                coarsePositions[coarseIndex[i]] = positions[i];
+                row.push_back(make_pair(coarseIndex[i], 1.0f));
+            }
+            else
+            {
+                float total = 0;
+                for (int k = start[i]; k < start[i + 1]; k++)
+                {
+                    int j = neighbours[k];
+                    if (coarseIndex[j] < 0) continue;
+                    float weight = 1.0f / max(glm::length(positions[i] - positions[j]), 1e-6f);
+                    row.push_back(make_pair(coarseIndex[j], weight));
+                    total += weight;
+                }
+                for (int k = 0; k < row.size(); k++)
+                    row[k].second /= total;
+                // the hole of the removed vertex is closed by joining its kept neighbours
+                for (int a = 0; a < row.size(); a++)
+                    for (int b = a + 1; b < row.size(); b++)
+                        coarseEdges.push_back(make_pair(min(row[a].first, row[b].first), max(row[a].first, row[b].first)));
+            }
+            sort(row.begin(), row.end());
+            for (int k = 0; k < row.size(); k++)
+            {
+                if (k > 0 && row[k].first == row[k - 1].first)
+                {
+                    P.value.back() += row[k].second;
+                    continue;
+                }
+                P.column.push_back(row[k].first);
+                P.value.push_back(row[k].second);
+            }
+            P.start[i + 1] = P.column.size();
+        }
+        sort(coarseEdges.begin(), coarseEdges.end());
+        coarseEdges.erase(unique(coarseEdges.begin(), coarseEdges.end()), coarseEdges.end());
+        positions.swap(coarsePositions);
+        edges.swap(coarseEdges);
+        return P;
+    }
+
+    void factorCoarsest()
+    {
+        const SparseMatrix& A = levels.back().A;
+        int n = A.rows;
+        if (n > maxDirectSize)
+        {
+            cholesky.clear();
+            return;
+        }
+        cholesky.assign(n * n, 0.0f);
+        for (int i = 0; i < n; i++)
+            for (int k = A.start[i]; k < A.start[i + 1]; k++)
+                if (A.column[k] <= i) cholesky[i * n + A.column[k]] = A.value[k];
+        for (int j = 0; j < n; j++)
+        {
+            float d = cholesky[j * n + j];
+            for (int k = 0; k < j; k++)
+                d -= cholesky[j * n + k] * cholesky[j * n + k];
+            d = sqrtf(max(d, 1e-12f));
+            cholesky[j * n + j] = d;
+            for (int i = j + 1; i < n; i++)
+            {
+                float s = cholesky[i * n + j];
+                for (int k = 0; k < j; k++)
+                    s -= cholesky[i * n + k] * cholesky[j * n + k];
+                cholesky[i * n + j] = s / d;
+            }
+        }
+    }
+
+    void solveCoarsest(vector<glm::vec3>& x, const vector<glm::vec3>& b)
+    {
+        int n = b.size();
+        if (cholesky.empty())
+        {
+            smooth(levels.back(), 4 * (preSmooth + postSmooth));
+            return;
+        }
+        scratch.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            glm::vec3 s = b[i];
+            for (int k = 0; k < i; k++)
+                s -= cholesky[i * n + k] * scratch[k];
+            scratch[i] = s / cholesky[i * n + i];
+        }
+        for (int i = n - 1; i >= 0; i--)
+        {
+            glm::vec3 s = scratch[i];
+            for (int k = i + 1; k < n; k++)
+                s -= cholesky[k * n + i] * x[k];
+            x[i] = s / cholesky[i * n + i];
+        }
+    }
+};
+#endif
@@ -0,0 +1,114 @@
+#ifndef NORMALS_H
+#define NORMALS_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <cmath>
+using namespace std;
+
+// Smooth vertex normals of a deforming triangle mesh: the area weighted face normals (unnormalised cross
+// products) are computed in parallel, one write per triangle, then every vertex sums the faces it lies in
+// through a CSR vertex -> triangles list and normalises. Both passes only gather, so there are no atomics
+// and no two tasks write the same memory; the adjacency is rebuilt only when the topology changes.
+class VertexNormals
+{
+public:
+    vector<glm::vec3> normals;          // per vertex, after Compute
+
+    void SetTopology(int vertexCount, const vector<unsigned int>& indices)
+    {
+        triangleStart.assign(vertexCount + 1, 0);
+        for (int i = 0; i < indices.size(); i++)
+            triangleStart[indices[i] + 1]++;
+        for (int v = 0; v < vertexCount; v++)
+            triangleStart[v + 1] += triangleStart[v];
+        triangleList.resize(indices.size());
+        vector<int> fill(triangleStart.begin(), triangleStart.end() - 1);
+        for (int i = 0; i < indices.size(); i++)
+            triangleList[fill[indices[i]]++] = i / 3;
+        indexCount = indices.size();
+    }
+
+    void Compute(const vector<Vertex>& vertices, const vector<unsigned int>& indices)
+    {
+        computeFaces([&](int i) -> const glm::vec3& { return vertices[i].Position; }, indices, faceNormals);
+        gatherAll(vertices.size(), faceNormals, normals);
+    }
+
+    // the same for bare positions, e.g. an instance of a ClothBatch
+    void Compute(const vector<glm::vec3>& positions, const vector<unsigned int>& indices)
+    {
+        computeFaces([&](int i) -> const glm::vec3& { return positions[i]; }, indices, faceNormals);
+        gatherAll(positions.size(), faceNormals, normals);
+    }
+
+    // the same into caller owned face and vertex normals, so many meshes of this topology (the instances of a
+    // ClothCrowd) share one adjacency and can be computed at the same time
+    void Compute(const vector<glm::vec3>& positions, const vector<unsigned int>& indices, vector<glm::vec3>& faces, vector<glm::vec3>& out) const
+    {
+        computeFaces([&](int i) -> const glm::vec3& { return positions[i]; }, indices, faces);
+        gatherAll(positions.size(), faces, out);
+    }
+
+    // recomputes the normals of a simulated mesh into its vertices, rebuilding the adjacency first when the
+    // counts or the given topology version changed since the last call
+    void Update(vector<Vertex>& vertices, const vector<unsigned int>& indices, int topology)
+    {
+        if (triangleStart.size() != vertices.size() + 1 || indexCount != indices.size() || topology != builtTopology)
+        {
+            SetTopology(vertices.size(), indices);
+            builtTopology = topology;
+        }
+        computeFaces([&](int i) -> const glm::vec3& { return vertices[i].Position; }, indices, faceNormals);
+        ParallelForRange(0, vertices.size(), [&](int begin, int end)
+            {
+                for (int v = begin; v < end; v++)
+                    vertices[v].Normal = gather(faceNormals, v);
+            }, 4096);
+    }
+
+private:
+    vector<glm::vec3> faceNormals;      // area weighted
+    vector<int> triangleStart;          // CSR vertex -> triangles
+    vector<int> triangleList;
+    size_t indexCount = 0;
+    int builtTopology = -1;
+
+    // position(i) gives the position of vertex i
+    template<typename Position>
+    static void computeFaces(const Position& position, const vector<unsigned int>& indices, vector<glm::vec3>& faces)
+    {
+        int triangleCount = indices.size() / 3;
+        faces.resize(triangleCount);
+        ParallelFor(0, triangleCount, [&](int t)
+            {
+                const glm::vec3& a = position(indices[3 * t]);
+                faces[t] = glm::cross(position(indices[3 * t + 1]) - a, position(indices[3 * t + 2]) - a);
+            }, 4096);
+    }
+
+    void gatherAll(int vertexCount, const vector<glm::vec3>& faces, vector<glm::vec3>& out) const
+    {
+        out.resize(vertexCount);
+        ParallelForRange(0, vertexCount, [&](int begin, int end)
+            {
+                for (int v = begin; v < end; v++)
+                    out[v] = gather(faces, v);
+            }, 4096);
+    }
+
+    // a vertex without triangles (or only degenerate ones) keeps facing up
+    glm::vec3 gather(const vector<glm::vec3>& faces, int v) const
+    {
+        glm::vec3 n(0);
+        for (int k = triangleStart[v]; k < triangleStart[v + 1]; k++)
+            n += faces[triangleList[k]];
+        float length = glm::length(n);
+        return length > 0 ? n / length : glm::vec3(0, 1, 0);
+    }
+};
+#endif
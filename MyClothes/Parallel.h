@@ -0,0 +1,163 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+// A small persistent worker pool. Work is handed out in chunks of `grain` indices through an atomic
+// counter and the calling thread helps, so a parallel loop costs a wake-up rather than a thread spawn.
+// Calls made from inside a job, on a worker or on the thread that submitted it, or while another thread
+// owns the pool, simply run serially.
+class ThreadPool
+{
+public:
+    static ThreadPool& Get()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(poolMutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (int i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    // number of threads taking part in a parallel loop, including the caller
+    int Size() const
+    {
+        return (int)workers.size() + 1;
+    }
+
+    void Run(int begin, int end, int grain, const function<void(int, int)>& body)
+    {
+        if (end <= begin) return;
+        grain = max(grain, 1);
+
+        // the submitting thread already holds submitMutex while it helps with its job
+        if (isWorker() || inRun() || workers.empty() || end - begin <= grain)
+        {
+            body(begin, end);
+            return;
+        }
+        unique_lock<mutex> submit(submitMutex, try_to_lock);
+        if (!submit.owns_lock())
+        {
+            body(begin, end);
+            return;
+        }
+        inRun() = true;
+
+        {
+            lock_guard<mutex> lock(poolMutex);
+            job = &body;
+            jobEnd = end;
+            jobGrain = grain;
+            next = begin;
+            active = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        work();
+
+        unique_lock<mutex> lock(poolMutex);
+        done.wait(lock, [this] { return active == 0; });
+        job = nullptr;
+        inRun() = false;
+    }
+
+private:
+    vector<thread> workers;
+    mutex submitMutex;
+    mutex poolMutex;
+    condition_variable wake;
+    condition_variable done;
+    const function<void(int, int)>* job = nullptr;
+    atomic<int> next;
+    int jobEnd = 0;
+    int jobGrain = 1;
+    int active = 0;
+    unsigned int generation = 0;
+    bool stop = false;
+
+    ThreadPool()
+    {
+        next = 0;
+        int count = (int)thread::hardware_concurrency() - 1;
+        for (int i = 0; i < count; i++)
+            workers.push_back(thread(&ThreadPool::loop, this));
+    }
+
+    static bool& isWorker()
+    {
+        static thread_local bool worker = false;
+        return worker;
+    }
+
+    // set on the submitting thread for the duration of its job
+    static bool& inRun()
+    {
+        static thread_local bool running = false;
+        return running;
+    }
+
+    void work()
+    {
+        for (;;)
+        {
+            int b = next.fetch_add(jobGrain);
+            if (b >= jobEnd) break;
+            (*job)(b, min(b + jobGrain, jobEnd));
+        }
+    }
+
+    void loop()
+    {
+        isWorker() = true;
+        unsigned int seen = 0;
+        for (;;)
+        {
+            {
+                unique_lock<mutex> lock(poolMutex);
+                wake.wait(lock, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+            work();
+            {
+                lock_guard<mutex> lock(poolMutex);
+                if (--active == 0) done.notify_one();
+            }
+        }
+    }
+};
+
+// runs func(i) for every i in [begin, end) across the pool
+template<typename F>
+void ParallelFor(int begin, int end, F func, int grain = 256)
+{
+    ThreadPool::Get().Run(begin, end, grain, [&func](int b, int e)
+        {
+            for (int i = b; i < e; i++)
+                func(i);
+        });
+}
+
+// runs func(b, e) on contiguous sub ranges of [begin, end), for loops that keep per chunk state
+template<typename F>
+void ParallelForRange(int begin, int end, F func, int grain = 256)
+{
+    ThreadPool::Get().Run(begin, end, grain, [&func](int b, int e) { func(b, e); });
+}
+#endif
@@ -0,0 +1,239 @@
+#ifndef PROJECTIVE_DYNAMICS_H
+#define PROJECTIVE_DYNAMICS_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Topology.h"
+#include "Multigrid.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <cmath>
+using namespace std;
+
+// Implicit spring step by projective dynamics (Bouaziz et al. 2014; Liu et al. 2013 for mass springs).
+// Each iteration projects every spring onto its rest length (local step, in parallel), then solves
+// (M / h^2 + sum k S^T S + pins) x = M / h^2 y + sum k S^T p for the positions (global step). The matrix
+// only changes with the step size or the pinned set, so its multigrid hierarchy is built once and each
+// global step is a V-cycle or two, warm started from the previous iterate. Stiff springs stay stable at
+// the frame step, and low frequency motion such as the sag of the whole sheet converges in as many cycles
+// on a fine cloth as on a coarse one. Local edits of the mesh (tearing, remeshing) keep the hierarchy: the
+// fine matrix is patched and the coarse levels are refreshed only once convergence suffers.
+class ProjectiveDynamics
+{
+public:
+    Multigrid multigrid;
+    int iterations = 4;         // local/global iterations per step
+    int cycles = 1;             // V-cycles per global step
+    float pinStiffness = 1e6f;
+    float residual = 0;         // relative residual of the last global step
+    float refreshFactor = 2;    // coarse levels left stale by UpdateTopology are refreshed once the residual
+    int refreshSteps = 30;      // grows by this factor over the last fresh one, or after this many steps
+
+    // springs of the structural and bending lists with their rest lengths from oldPos, or from the given
+    // rest positions when the particles were not all created at rest (remeshing)
+    void SetTopology(const vector<Vertex>& vertices, const vector<Edge>& edges, const vector<Edge>& diagonals, float structuralStiffness, float bendingStiffness, const vector<glm::vec3>* restPositions = NULL)
+    {
+        buildSprings(vertices, edges, diagonals, structuralStiffness, bendingStiffness, restPositions);
+        pinned.clear();
+        stepSize = 0;
+        topologyChanged = false;
+    }
+
+    // the same after a local edit of the mesh; origin names for every vertex the one it was before the edit,
+    // or the one it was copied from. Nothing is rebuilt here, so the explicit solver pays nothing for it:
+    // the next Step patches the fine level of the hierarchy and leaves the coarse ones for later.
+    void UpdateTopology(const vector<Vertex>& vertices, const vector<Edge>& edges, const vector<Edge>& diagonals, float structuralStiffness, float bendingStiffness,
+        const vector<glm::vec3>* restPositions, const vector<int>& origin)
+    {
+        buildSprings(vertices, edges, diagonals, structuralStiffness, bendingStiffness, restPositions);
+        if (stepSize == 0) return;
+        int n = vertices.size();
+        vector<int> built(n);
+        vector<char> wasPinned(n);
+        for (int i = 0; i < n; i++)
+        {
+            built[i] = builtOrigin[origin[i]];
+            wasPinned[i] = pinned[origin[i]];
+        }
+        builtOrigin.swap(built);
+        pinned.swap(wasPinned);
+        topologyChanged = true;
+    }
+
+    // advances the particles by h from their current positions, velocities and accumulated forces;
+    // like SimulateNodes it leaves fixed particles alone and clears the forces of the others
+    void Step(vector<Vertex>& vertices, float h)
+    {
+        int n = vertices.size();
+        if (n == 0 || springStart.size() != n + 1) return;
+        setup(vertices, h);
+        if (multigrid.Stale()) staleSteps++;
+
+        // inertial target
+        inertia.resize(n);
+        x.resize(n);
+        ParallelFor(0, n, [&](int i)
+            {
+                const Vertex& v = vertices[i];
+                inertia[i] = v.isFixed ? v.Position : v.Position + h * v.velocity + h * h * v.force / v.mass;
+                x[i] = inertia[i];
+            }, 4096);
+
+        projection.resize(springs.size());
+        rhs.resize(n);
+        for (int iteration = 0; iteration < iterations; iteration++)
+        {
+            // local: the nearest configuration of every spring that has its rest length
+            ParallelFor(0, springs.size(), [&](int s)
+                {
+                    glm::vec3 d = x[springs[s].first] - x[springs[s].second];
+                    float length = glm::length(d);
+                    projection[s] = length > 1e-12f ? d * (springs[s].rest / length) : glm::vec3(0);
+                }, 4096);
+
+            // global
+            ParallelFor(0, n, [&](int i)
+                {
+                    const Vertex& v = vertices[i];
+                    glm::vec3 b = v.mass / (h * h) * inertia[i];
+                    if (v.isFixed) b += pinStiffness * v.Position;
+                    for (int k = springStart[i]; k < springStart[i + 1]; k++)
+                    {
+                        const ProjectiveSpring& spring = springs[springList[k]];
+                        b += (spring.first == i ? spring.stiffness : -spring.stiffness) * projection[springList[k]];
+                    }
+                    rhs[i] = b;
+                }, 2048);
+            for (int c = 0; c < cycles; c++)
+                multigrid.VCycle(x, rhs);
+        }
+        residual = multigrid.Residual(x, rhs);
+        if (!multigrid.Stale()) freshResidual = residual;
+        else if (residual > refreshFactor * freshResidual || staleSteps >= refreshSteps)
+        {
+            multigrid.RefreshCoarse();
+            staleSteps = 0;
+        }
+
+        ParallelFor(0, n, [&](int i)
+            {
+                Vertex& v = vertices[i];
+                if (v.isFixed) return;
+                v.velocity = (x[i] - v.Position) / h;
+                v.acceleration = v.force / v.mass;
+                v.oldPos = v.Position;
+                v.Position = x[i];
+                v.force = glm::vec3(0);
+            }, 4096);
+    }
+
+private:
+    struct ProjectiveSpring {
+        int first;
+        int second;
+        float rest;
+        float stiffness;
+    };
+    vector<ProjectiveSpring> springs;
+    vector<int> springStart;
+    vector<int> springList;
+    vector<char> pinned;        // pinned set and step the matrix was built for
+    vector<glm::vec3> meshPositions;
+    vector<pair<int, int>> meshEdges;
+    float stepSize = 0;
+    vector<int> builtOrigin;    // vertex of the mesh the hierarchy was built on, for every current vertex
+    bool topologyChanged = false;
+    float freshResidual = 0;
+    int staleSteps = 0;
+    vector<glm::vec3> inertia, x, projection, rhs;
+
+    void buildSprings(const vector<Vertex>& vertices, const vector<Edge>& edges, const vector<Edge>& diagonals, float structuralStiffness, float bendingStiffness, const vector<glm::vec3>* restPositions)
+    {
+        springs.clear();
+        for (int i = 0; i < edges.size(); i++)
+            addSpring(vertices, restPositions, edges[i], structuralStiffness);
+        // the cloth at rest, decimated by the multigrid
+        int n = vertices.size();
+        meshPositions.resize(n);
+        for (int i = 0; i < n; i++)
+            meshPositions[i] = restPositions ? (*restPositions)[i] : vertices[i].oldPos;
+        meshEdges.resize(edges.size());
+        for (int i = 0; i < edges.size(); i++)
+            meshEdges[i] = make_pair(edges[i].firstVertex, edges[i].secondVertex);
+        for (int i = 0; i < diagonals.size(); i++)
+            addSpring(vertices, restPositions, diagonals[i], bendingStiffness);
+
+        // CSR particle -> springs, for gathering the right hand side
+        springStart.assign(n + 1, 0);
+        for (int s = 0; s < springs.size(); s++) { springStart[springs[s].first + 1]++; springStart[springs[s].second + 1]++; }
+        for (int i = 0; i < n; i++)
+            springStart[i + 1] += springStart[i];
+        springList.resize(springStart[n]);
+        vector<int> fill(springStart.begin(), springStart.end() - 1);
+        for (int s = 0; s < springs.size(); s++) { springList[fill[springs[s].first]++] = s; springList[fill[springs[s].second]++] = s; }
+    }
+
+    void addSpring(const vector<Vertex>& vertices, const vector<glm::vec3>* restPositions, const Edge& e, float stiffness)
+    {
+        float rest = restPositions ? glm::length((*restPositions)[e.firstVertex] - (*restPositions)[e.secondVertex])
+            : glm::length(vertices[e.firstVertex].oldPos - vertices[e.secondVertex].oldPos);
+        ProjectiveSpring spring = { e.firstVertex, e.secondVertex, rest, stiffness };
+        springs.push_back(spring);
+    }
+
+    // (re)builds the system matrix and its hierarchy when the step size or the pinned particles change; after
+    // UpdateTopology only the fine level is patched, unless the mesh has changed too much since the build
+    void setup(const vector<Vertex>& vertices, float h)
+    {
+        int n = vertices.size();
+        bool changed = h != stepSize || pinned.size() != n;
+        for (int i = 0; i < n && !changed; i++)
+            changed = pinned[i] != (char)vertices[i].isFixed;
+        if (!changed && !topologyChanged) return;
+        topologyChanged = false;
+        stepSize = h;
+        pinned.resize(n);
+        for (int i = 0; i < n; i++)
+            pinned[i] = vertices[i].isFixed;
+
+        // rows are the particle itself plus its spring partners, sorted
+        SparseMatrix A;
+        A.rows = A.columns = n;
+        A.start.assign(n + 1, 0);
+        vector<pair<int, float>> row;
+        for (int i = 0; i < n; i++)
+        {
+            row.clear();
+            float diagonal = vertices[i].mass / (h * h) + (vertices[i].isFixed ? pinStiffness : 0.0f);
+            for (int k = springStart[i]; k < springStart[i + 1]; k++)
+            {
+                const ProjectiveSpring& spring = springs[springList[k]];
+                diagonal += spring.stiffness;
+                row.push_back(make_pair(spring.first == i ? spring.second : spring.first, -spring.stiffness));
+            }
+            row.push_back(make_pair(i, diagonal));
+            sort(row.begin(), row.end());
+            for (int k = 0; k < row.size(); k++)
+            {
+                // a pair joined by two springs gets one entry
+                if (k > 0 && row[k].first == row[k - 1].first)
+                {
+                    A.value.back() += row[k].second;
+                    continue;
+                }
+                A.column.push_back(row[k].first);
+                A.value.push_back(row[k].second);
+            }
+            A.start[i + 1] = A.column.size();
+        }
+        if (!changed && multigrid.UpdateFine(A, builtOrigin)) return;
+        multigrid.Setup(A, meshPositions, meshEdges);
+        builtOrigin.resize(n);
+        for (int i = 0; i < n; i++)
+            builtOrigin[i] = i;
+        staleSteps = 0;
+    }
+};
+#endif
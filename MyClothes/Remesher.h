@@ -0,0 +1,674 @@
+#ifndef REMESHER_H
+#define REMESHER_H
+
+#include <glm/glm.hpp>
+
+#include "IncrementalMesh.h"
+
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+#define REMESH_SPLIT 0
+#define REMESH_COLLAPSE 1
+#define REMESH_FLIP 2
+
+struct RemeshOperation {
+    int type;
+    int first;      // split, flip: the edge; collapse: the vertex removed and the one it merges into
+    int second;
+    float priority;
+};
+
+// Adaptive remeshing of a single cloth mesh (after Narain et al., "Adaptive anisotropic remeshing for cloth
+// simulation"). Edges that bend sharply, stretch or shear fast are split at their midpoint, vertices added
+// that way are collapsed back once their surroundings are flat and calm again, and edge flips keep the
+// triangles Delaunay in the rest (material) space. The vertices of the original mesh are never removed.
+//
+// Choosing the operations needs a pass over the whole mesh, so it runs on a worker thread over a snapshot
+// while the simulation continues; the operations touch disjoint vertex neighbourhoods and are applied
+// afterwards between two frames. Applying is local, through the edge map of IncrementalMesh; the vertex
+// array needs capacity for the whole particle budget.
+class AdaptiveRemesher : public IncrementalMesh
+{
+public:
+    float curvatureAngle = 0.35f;   // dihedral angle (radians) across an edge above which it is split
+    float strainLimit = 0.1f;       // relative stretch above which an edge is split
+    float velocityLimit = 20.0f;    // relative speed of the end points per rest length (1/s)
+    float minEdgeLength = 0.02f;    // rest length of the shortest edges a split may create
+    int budget = 0;                 // most particles at any time
+    int interval = 10;              // frames between passes
+    int splits = 0;                 // operations applied by the last pass
+    int collapses = 0;
+    int flips = 0;
+    float planMs = 0;               // of the last applied pass
+
+    ~AdaptiveRemesher()
+    {
+        if (worker.joinable()) worker.join();
+    }
+
+    // takes over the springs of the mesh, see IncrementalMesh::Setup
+    void Setup(vector<Vertex>& vertices, const vector<unsigned int>& indices, vector<Spring>& springs, float structural, float bending, float damping)
+    {
+        if (worker.joinable()) worker.join();
+        IncrementalMesh::Setup(vertices, indices, springs, structural, bending, damping);
+        originalCount = vertices.size();
+    }
+
+    bool Busy() const
+    {
+        return worker.joinable();
+    }
+
+    // for every triangle, the one it was before the last Apply; the new half of a split names the triangle
+    // it was split off
+    const vector<int>& TriangleOrigins() const
+    {
+        return triangleOrigin;
+    }
+
+    // snapshots the mesh and chooses the next operations on the worker thread
+    void Plan(const vector<Vertex>& vertices, const vector<unsigned int>& indices)
+    {
+        if (worker.joinable()) return;
+        int n = vertices.size();
+        snapshotPosition.resize(n);
+        snapshotVelocity.resize(n);
+        snapshotFixed.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            snapshotPosition[i] = vertices[i].Position;
+            snapshotVelocity[i] = vertices[i].velocity;
+            snapshotFixed[i] = vertices[i].isFixed;
+        }
+        snapshotRest = rest;
+        snapshotIndices = indices;
+        snapshotCapacity = min((int)vertices.capacity(), budget > 0 ? budget : (int)vertices.capacity());
+        done = false;
+        worker = thread([this]()
+            {
+                auto t0 = chrono::steady_clock::now();
+                plan();
+                workerPlanMs = chrono::duration<float, milli>(chrono::steady_clock::now() - t0).count();
+                done = true;
+            });
+    }
+
+    // applies the finished plan; true when the mesh changed, the caller then refreshes what depends on it
+    bool Apply(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs)
+    {
+        if (!worker.joinable() || !done) return false;
+        worker.join();
+        planMs = workerPlanMs;
+        splits = collapses = flips = 0;
+        moved.clear();
+        beginEdit(vertices.size());
+        triangleOrigin.resize(indices.size() / 3);
+        for (int t = 0; t < triangleOrigin.size(); t++)
+            triangleOrigin[t] = t;
+        for (int i = 0; i < operations.size(); i++)
+        {
+            const RemeshOperation& op = operations[i];
+            int a = current(op.first), b = current(op.second);
+            if (op.type == REMESH_SPLIT && vertices.size() < vertices.capacity() && split(vertices, indices, springs, a, b)) splits++;
+            if (op.type == REMESH_FLIP && flip(vertices, indices, springs, a, b)) flips++;
+            if (op.type == REMESH_COLLAPSE && collapse(vertices, indices, springs, a, b)) collapses++;
+        }
+        return splits + collapses + flips > 0;
+    }
+
+private:
+    int originalCount = 0;
+    unordered_map<int, int> moved;      // vertices renumbered by collapses during Apply
+    vector<int> triangleOrigin;
+
+    thread worker;
+    atomic<bool> done{ false };
+    float workerPlanMs = 0;             // written by the worker, read only after joining it
+    vector<glm::vec3> snapshotPosition, snapshotVelocity, snapshotRest;
+    vector<char> snapshotFixed;
+    vector<unsigned int> snapshotIndices;
+    int snapshotCapacity = 0;
+    vector<RemeshOperation> operations;
+
+    int current(int v) const
+    {
+        auto it = moved.find(v);
+        while (it != moved.end())
+        {
+            v = it->second;
+            it = moved.find(v);
+        }
+        return v;
+    }
+
+    // ---- planning, on the worker thread, reads only the snapshot ----
+
+    void plan()
+    {
+        operations.clear();
+        const vector<unsigned int>& indices = snapshotIndices;
+        int n = snapshotPosition.size();
+        int triangleCount = indices.size() / 3;
+
+        unordered_map<uint64_t, pair<int, int>> edgeTriangles;
+        vector<vector<int>> around(n);
+        for (int t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+            {
+                around[indices[3 * t + k]].push_back(t);
+                auto found = edgeTriangles.insert(make_pair(key(indices[3 * t + k], indices[3 * t + (k + 1) % 3]), make_pair(t, -1)));
+                if (!found.second) found.first->second.second = t;
+            }
+        auto faceNormal = [&](int t)
+        {
+            const glm::vec3& a = snapshotPosition[indices[3 * t]];
+            glm::vec3 normal = glm::cross(snapshotPosition[indices[3 * t + 1]] - a, snapshotPosition[indices[3 * t + 2]] - a);
+            float length = glm::length(normal);
+            return length > 0 ? normal / length : normal;
+        };
+
+        // how much an edge asks for refinement, above 1 it is split
+        unordered_map<uint64_t, float> score;
+        vector<RemeshOperation> splitOps, collapseOps, flipOps;
+        for (auto it = edgeTriangles.begin(); it != edgeTriangles.end(); ++it)
+        {
+            int a = first(it->first), b = second(it->first);
+            float restLength = glm::length(snapshotRest[a] - snapshotRest[b]);
+            if (restLength <= 0) continue;
+            float s = (glm::length(snapshotPosition[a] - snapshotPosition[b]) / restLength - 1) / strainLimit;
+            s = max(s, glm::length(snapshotVelocity[a] - snapshotVelocity[b]) / restLength / velocityLimit);
+            if (it->second.second >= 0)
+            {
+                float c = glm::clamp(glm::dot(faceNormal(it->second.first), faceNormal(it->second.second)), -1.0f, 1.0f);
+                s = max(s, acosf(c) / curvatureAngle);
+            }
+            score[it->first] = s;
+            if (s > 1 && restLength >= 2 * minEdgeLength)
+            {
+                RemeshOperation op = { REMESH_SPLIT, a, b, s };
+                splitOps.push_back(op);
+            }
+        }
+
+        // added vertices whose edges have all calmed down go back into a neighbour
+        for (int m = originalCount; m < n; m++)
+        {
+            if (snapshotFixed[m]) continue;
+            vector<int> ring;
+            bool calm = true;
+            for (int i = 0; i < around[m].size() && calm; i++)
+                for (int k = 0; k < 3; k++)
+                {
+                    int v = indices[3 * around[m][i] + k];
+                    if (v == m || find(ring.begin(), ring.end(), v) != ring.end()) continue;
+                    ring.push_back(v);
+                    calm = calm && score[key(m, v)] < 0.5f;
+                }
+            if (!calm) continue;
+            int target = collapseTarget(m, ring, around, edgeTriangles);
+            if (target < 0) continue;
+            RemeshOperation op = { REMESH_COLLAPSE, m, target, 0 };
+            collapseOps.push_back(op);
+        }
+
+        // flips that make the rest space triangulation Delaunay
+        for (auto it = edgeTriangles.begin(); it != edgeTriangles.end(); ++it)
+        {
+            if (it->second.second < 0) continue;
+            int a = first(it->first), b = second(it->first);
+            int c = opposite(indices, it->second.first, a, b), d = opposite(indices, it->second.second, a, b);
+            if (c == d || edgeTriangles.count(key(c, d)) || around[a].size() <= 3 || around[b].size() <= 3) continue;
+            float excess = restAngle(c, a, b) + restAngle(d, a, b) - 3.14159265f;
+            if (excess < 0.05f || !flipKeepsOrientation(it->second.first, it->second.second, a, b)) continue;
+            RemeshOperation op = { REMESH_FLIP, a, b, excess };
+            flipOps.push_back(op);
+        }
+
+        // an independent set: no two operations share a vertex neighbourhood
+        vector<char> locked(n, 0);
+        auto lockable = [&](const vector<int>& vs)
+        {
+            for (int i = 0; i < vs.size(); i++)
+                if (locked[vs[i]]) return false;
+            for (int i = 0; i < vs.size(); i++)
+                locked[vs[i]] = 1;
+            return true;
+        };
+        auto byPriority = [](const RemeshOperation& x, const RemeshOperation& y) { return x.priority > y.priority; };
+        sort(splitOps.begin(), splitOps.end(), byPriority);
+        sort(flipOps.begin(), flipOps.end(), byPriority);
+
+        int count = n;
+        for (int i = 0; i < collapseOps.size(); i++)
+        {
+            vector<int> vs(1, collapseOps[i].first);
+            for (int t = 0; t < around[collapseOps[i].first].size(); t++)
+                for (int k = 0; k < 3; k++)
+                    vs.push_back(indices[3 * around[collapseOps[i].first][t] + k]);
+            sort(vs.begin(), vs.end());
+            vs.erase(unique(vs.begin(), vs.end()), vs.end());
+            if (!lockable(vs)) continue;
+            operations.push_back(collapseOps[i]);
+            count--;
+        }
+        for (int i = 0; i < splitOps.size() && count < snapshotCapacity; i++)
+        {
+            const pair<int, int>& tris = edgeTriangles[key(splitOps[i].first, splitOps[i].second)];
+            vector<int> vs;
+            vs.push_back(splitOps[i].first);
+            vs.push_back(splitOps[i].second);
+            vs.push_back(opposite(indices, tris.first, splitOps[i].first, splitOps[i].second));
+            if (tris.second >= 0) vs.push_back(opposite(indices, tris.second, splitOps[i].first, splitOps[i].second));
+            if (!lockable(vs)) continue;
+            operations.push_back(splitOps[i]);
+            count++;
+        }
+        for (int i = 0; i < flipOps.size(); i++)
+        {
+            const pair<int, int>& tris = edgeTriangles[key(flipOps[i].first, flipOps[i].second)];
+            vector<int> vs;
+            vs.push_back(flipOps[i].first);
+            vs.push_back(flipOps[i].second);
+            vs.push_back(opposite(indices, tris.first, flipOps[i].first, flipOps[i].second));
+            vs.push_back(opposite(indices, tris.second, flipOps[i].first, flipOps[i].second));
+            if (!lockable(vs)) continue;
+            operations.push_back(flipOps[i]);
+        }
+        // collapses renumber vertices, so they go last
+        stable_sort(operations.begin(), operations.end(), [](const RemeshOperation& x, const RemeshOperation& y) { return (x.type == REMESH_COLLAPSE) < (y.type == REMESH_COLLAPSE); });
+    }
+
+    // angle at vertex v of the rest space triangle (v, a, b)
+    float restAngle(int v, int a, int b) const
+    {
+        glm::vec3 e0 = snapshotRest[a] - snapshotRest[v], e1 = snapshotRest[b] - snapshotRest[v];
+        float l = glm::length(e0) * glm::length(e1);
+        return l > 0 ? acosf(glm::clamp(glm::dot(e0, e1) / l, -1.0f, 1.0f)) : 0;
+    }
+
+    // the flipped pair must face the same way as the old pair in the rest space
+    bool flipKeepsOrientation(int t0, int t1, int a, int b) const
+    {
+        const vector<unsigned int>& indices = snapshotIndices;
+        const vector<glm::vec3>& r = snapshotRest;
+        for (int k = 0; k < 3; k++)
+            if (indices[3 * t0 + k] == b && indices[3 * t0 + (k + 1) % 3] == a) swap(t0, t1);
+        int c = opposite(indices, t0, a, b), d = opposite(indices, t1, a, b);
+        glm::vec3 before = glm::cross(r[b] - r[a], r[c] - r[a]) + glm::cross(r[a] - r[b], r[d] - r[b]);
+        glm::vec3 n0 = glm::cross(r[a] - r[c], r[d] - r[c]);
+        glm::vec3 n1 = glm::cross(r[b] - r[d], r[c] - r[d]);
+        return glm::dot(before, n0) > 0 && glm::dot(before, n1) > 0;
+    }
+
+    // a neighbour m can merge into without breaking the manifold (link condition) or folding a triangle,
+    // preferring the one leaving the best shaped triangles; -1 when there is none
+    int collapseTarget(int m, const vector<int>& ring, const vector<vector<int>>& around, const unordered_map<uint64_t, pair<int, int>>& edgeTriangles) const
+    {
+        const vector<unsigned int>& indices = snapshotIndices;
+        bool boundaryVertex = false;
+        for (int i = 0; i < ring.size(); i++)
+            boundaryVertex = boundaryVertex || edgeTriangles.at(key(m, ring[i])).second < 0;
+
+        int best = -1;
+        float bestQuality = 0.2f;
+        for (int i = 0; i < ring.size(); i++)
+        {
+            int n = ring[i];
+            const pair<int, int>& shared = edgeTriangles.at(key(m, n));
+            if (boundaryVertex && shared.second >= 0) continue;
+            // common neighbours must be exactly the opposite vertices of the edge
+            int common = 0;
+            for (int j = 0; j < ring.size(); j++)
+                if (ring[j] != n && edgeTriangles.count(key(n, ring[j]))) common++;
+            if (common != (shared.second >= 0 ? 2 : 1)) continue;
+
+            float quality = 1;
+            bool folds = false;
+            for (int t = 0; t < around[m].size() && !folds; t++)
+            {
+                int tri = around[m][t];
+                if (tri == shared.first || tri == shared.second) continue;
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    int v = indices[3 * tri + k];
+                    p[k] = snapshotRest[v];
+                    q[k] = snapshotRest[v == m ? n : v];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]), after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                folds = glm::dot(before, after) <= 0;
+                // area over squared longest edge, relative to the equilateral triangle
+                float longest = max(glm::dot(q[1] - q[0], q[1] - q[0]), max(glm::dot(q[2] - q[1], q[2] - q[1]), glm::dot(q[0] - q[2], q[0] - q[2])));
+                quality = min(quality, longest > 0 ? glm::length(after) / longest / 0.866f : 0.0f);
+            }
+            if (!folds && quality > bestQuality)
+            {
+                bestQuality = quality;
+                best = n;
+            }
+        }
+        return best;
+    }
+
+    // ---- applying, on the simulation thread ----
+
+    bool split(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs, int a, int b)
+    {
+        auto it = edges.find(key(a, b));
+        if (it == edges.end()) return false;
+        MeshEdge old = it->second;
+        edges.erase(it);
+
+        int m = vertices.size();
+        Vertex mid = vertices[a];
+        const Vertex& vb = vertices[b];
+        mid.Position = 0.5f * (mid.Position + vb.Position);
+        mid.oldPos = 0.5f * (mid.oldPos + vb.oldPos);
+        mid.velocity = 0.5f * (mid.velocity + vb.velocity);
+        mid.Normal = 0.5f * (mid.Normal + vb.Normal);
+        mid.TexCoords = 0.5f * (mid.TexCoords + vb.TexCoords);
+        mid.Tangent = 0.5f * (mid.Tangent + vb.Tangent);
+        mid.Bitangent = 0.5f * (mid.Bitangent + vb.Bitangent);
+        mid.force = glm::vec3(0);
+        mid.isFixed = false;
+        vertices.push_back(mid);
+        rest.push_back(0.5f * (rest[a] + rest[b]));
+        vertexOrigin.push_back(vertexOrigin[a]);
+        vertexSource.push_back(-1);
+        vertexTriangles.push_back(vector<int>());
+
+        // the old spring keeps the a half, its bending spring stays across it
+        MeshEdge half = { { -1, -1 }, old.structural, old.bending, false };
+        edges[key(a, m)] = half;
+        springKeys[old.structural] = key(a, m);
+        if (old.bending >= 0) springKeys[old.bending] = key(a, m);
+        bindSpring(vertices, springs, old.structural, a, m);
+        MeshEdge other = { { -1, -1 }, -1, -1, false };
+        edges[key(m, b)] = other;
+        edges[key(m, b)].structural = addSpring(vertices, springs, m, b, key(m, b), false);
+
+        vector<uint64_t> touched;
+        touched.push_back(key(a, m));
+        touched.push_back(key(m, b));
+        for (int side = 0; side < 2; side++)
+        {
+            int t = old.triangle[side];
+            if (t < 0) continue;
+            int c = opposite(indices, t, a, b);
+            // t keeps a and gets m for b, the new triangle gets m for a, both keep the winding
+            int added = indices.size() / 3;
+            for (int k = 0; k < 3; k++)
+                indices.push_back(indices[3 * t + k]);
+            triangleOrigin.push_back(triangleOrigin[t]);
+            replaceVertex(indices, t, b, m);
+            replaceVertex(indices, added, a, m);
+
+            attach(a, m, t);
+            attach(m, b, added);
+            MeshEdge spoke = { { t, added }, -1, -1, false };
+            edges[key(m, c)] = spoke;
+            edges[key(m, c)].structural = addSpring(vertices, springs, m, c, key(m, c), false);
+            replaceTriangle(key(b, c), t, added);
+
+            eraseValue(vertexTriangles[b], t);
+            vertexTriangles[b].push_back(added);
+            vertexTriangles[c].push_back(added);
+            vertexTriangles[m].push_back(t);
+            vertexTriangles[m].push_back(added);
+
+            touched.push_back(key(m, c));
+            touched.push_back(key(a, c));
+            touched.push_back(key(b, c));
+        }
+        for (int i = 0; i < touched.size(); i++)
+            updateBending(vertices, indices, springs, touched[i]);
+        return true;
+    }
+
+    bool flip(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs, int a, int b)
+    {
+        auto it = edges.find(key(a, b));
+        if (it == edges.end() || it->second.triangle[1] < 0) return false;
+        MeshEdge old = it->second;
+        // orient so that t0 runs a -> b and t1 runs b -> a
+        int t0 = old.triangle[0], t1 = old.triangle[1];
+        for (int k = 0; k < 3; k++)
+            if (indices[3 * t0 + k] == b && indices[3 * t0 + (k + 1) % 3] == a) swap(t0, t1);
+        int c = opposite(indices, t0, a, b), d = opposite(indices, t1, a, b);
+        if (c == d || edges.count(key(c, d))) return false;
+        edges.erase(it);
+
+        indices[3 * t0] = c; indices[3 * t0 + 1] = a; indices[3 * t0 + 2] = d;
+        indices[3 * t1] = d; indices[3 * t1 + 1] = b; indices[3 * t1 + 2] = c;
+
+        MeshEdge diagonal = { { t0, t1 }, old.structural, old.bending, false };
+        edges[key(c, d)] = diagonal;
+        springKeys[old.structural] = key(c, d);
+        if (old.bending >= 0) springKeys[old.bending] = key(c, d);
+        bindSpring(vertices, springs, old.structural, c, d);
+        replaceTriangle(key(b, c), t0, t1);
+        replaceTriangle(key(a, d), t1, t0);
+
+        eraseValue(vertexTriangles[a], t1);
+        eraseValue(vertexTriangles[b], t0);
+        vertexTriangles[c].push_back(t1);
+        vertexTriangles[d].push_back(t0);
+
+        uint64_t touched[5] = { key(c, d), key(a, c), key(b, c), key(a, d), key(b, d) };
+        for (int i = 0; i < 5; i++)
+            updateBending(vertices, indices, springs, touched[i]);
+        return true;
+    }
+
+    bool collapse(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs, int m, int n)
+    {
+        if (m < originalCount || m == n || !edges.count(key(m, n))) return false;
+        MeshEdge shared = edges[key(m, n)];
+        vector<int> triangles = vertexTriangles[m];
+
+        // the triangles on the collapsing edge go away, the others swap m for n
+        vector<uint64_t> touched;
+        for (int i = 0; i < triangles.size(); i++)
+        {
+            int t = triangles[i];
+            if (t == shared.triangle[0] || t == shared.triangle[1]) continue;
+            for (int k = 0; k < 3; k++)
+            {
+                int v = indices[3 * t + k];
+                if (v == m) continue;
+                uint64_t from = key(m, v), to = key(n, v);
+                auto spoke = edges.find(from);
+                if (spoke == edges.end()) continue;
+                if (!edges.count(to))
+                {
+                    // the spoke becomes an edge of n
+                    MeshEdge e = spoke->second;
+                    edges.erase(spoke);
+                    edges[to] = e;
+                    springKeys[e.structural] = to;
+                    if (e.bending >= 0) springKeys[e.bending] = to;
+                    bindSpring(vertices, springs, e.structural, n, v);
+                }
+                else
+                {
+                    // spokes next to the collapsing edge merge with an edge n already has
+                    MeshEdge e = spoke->second;
+                    edges.erase(spoke);
+                    MeshEdge& target = edges[to];
+                    int survivor = e.triangle[0] == shared.triangle[0] || e.triangle[0] == shared.triangle[1] ? e.triangle[1] : e.triangle[0];
+                    if (target.triangle[0] == shared.triangle[0] || target.triangle[0] == shared.triangle[1]) target.triangle[0] = survivor;
+                    else target.triangle[1] = survivor;
+                    removeStructural(springs, e);
+                }
+                touched.push_back(to);
+            }
+            replaceVertex(indices, t, m, n);
+            vertexTriangles[n].push_back(t);
+        }
+        // what is left of m: the collapsing edge and the spokes only the removed triangles had
+        for (int side = 0; side < 2; side++)
+        {
+            int t = shared.triangle[side];
+            if (t < 0) continue;
+            int c = opposite(indices, t, m, n);
+            auto spoke = edges.find(key(m, c));
+            if (spoke != edges.end())
+            {
+                MeshEdge e = spoke->second;
+                edges.erase(spoke);
+                removeStructural(springs, e);
+                MeshEdge& target = edges[key(n, c)];
+                int survivor = e.triangle[0] == t ? e.triangle[1] : e.triangle[0];
+                if (target.triangle[0] == t) target.triangle[0] = survivor;
+                else if (target.triangle[1] == t) target.triangle[1] = survivor;
+            }
+            touched.push_back(key(n, c));
+        }
+        auto centre = edges.find(key(m, n));
+        if (centre != edges.end())
+        {
+            MeshEdge e = centre->second;
+            edges.erase(centre);
+            removeStructural(springs, e);
+        }
+
+        int removed[2] = { shared.triangle[0], shared.triangle[1] };
+        if (removed[0] < removed[1]) swap(removed[0], removed[1]);
+        for (int i = 0; i < 2; i++)
+            if (removed[i] >= 0) removeTriangle(indices, removed[i]);
+        vertexTriangles[m].clear();
+        removeVertex(vertices, indices, springs, m);
+        int moved_n = current(n);
+        for (int i = 0; i < touched.size(); i++)
+        {
+            int p = current(first(touched[i]) == m ? n : first(touched[i]));
+            int q = current(second(touched[i]) == m ? n : second(touched[i]));
+            updateBending(vertices, indices, springs, key(p, q));
+        }
+        // the bending springs across the link edges of n now reach n instead of m
+        for (int i = 0; i < vertexTriangles[moved_n].size(); i++)
+        {
+            int t = vertexTriangles[moved_n][i];
+            for (int k = 0; k < 3; k++)
+            {
+                int p = indices[3 * t + k], q = indices[3 * t + (k + 1) % 3];
+                if (p != moved_n && q != moved_n) updateBending(vertices, indices, springs, key(p, q));
+            }
+        }
+        return true;
+    }
+
+    // swap and pop of a triangle, the one moved into the hole is renamed in its edges and vertices
+    void removeTriangle(vector<unsigned int>& indices, int t)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            int v = indices[3 * t + k];
+            eraseValue(vertexTriangles[v], t);
+            dropTriangle(key(v, indices[3 * t + (k + 1) % 3]), t);
+        }
+        int last = indices.size() / 3 - 1;
+        if (t != last)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                int v = indices[3 * last + k];
+                indices[3 * t + k] = v;
+                replace(vertexTriangles[v].begin(), vertexTriangles[v].end(), last, t);
+                replaceTriangle(key(v, indices[3 * last + (k + 1) % 3]), last, t);
+            }
+            triangleOrigin[t] = triangleOrigin[last];
+        }
+        indices.resize(3 * last);
+        triangleOrigin.pop_back();
+    }
+
+    // swap and pop of a vertex; everything that referred to the last vertex is re-pointed
+    void removeVertex(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs, int m)
+    {
+        int last = vertices.size() - 1;
+        if (m != last)
+        {
+            vertices[m] = vertices[last];
+            rest[m] = rest[last];
+            vertexOrigin[m] = vertexOrigin[last];
+            vertexSource[m] = vertexSource[last];
+            vertexTriangles[m].swap(vertexTriangles[last]);
+            Vertex* from = &vertices[last];
+            for (int i = 0; i < vertexTriangles[m].size(); i++)
+            {
+                int t = vertexTriangles[m][i];
+                replaceVertex(indices, t, last, m);
+            }
+            // re-key the edges of the moved vertex, then re-point every spring that reached it
+            vector<pair<uint64_t, MeshEdge>> rekeyed;
+            for (int i = 0; i < vertexTriangles[m].size(); i++)
+            {
+                int t = vertexTriangles[m][i];
+                for (int k = 0; k < 3; k++)
+                {
+                    int v = indices[3 * t + k];
+                    if (v == m) continue;
+                    auto it = edges.find(key(last, v));
+                    if (it == edges.end()) continue;
+                    rekeyed.push_back(make_pair(key(m, v), it->second));
+                    edges.erase(it);
+                }
+            }
+            for (int i = 0; i < rekeyed.size(); i++)
+            {
+                edges[rekeyed[i].first] = rekeyed[i].second;
+                springKeys[rekeyed[i].second.structural] = rekeyed[i].first;
+                if (rekeyed[i].second.bending >= 0) springKeys[rekeyed[i].second.bending] = rekeyed[i].first;
+            }
+            for (int i = 0; i < vertexTriangles[m].size(); i++)
+            {
+                int t = vertexTriangles[m][i];
+                for (int k = 0; k < 3; k++)
+                {
+                    int p = indices[3 * t + k], q = indices[3 * t + (k + 1) % 3];
+                    auto it = edges.find(key(p, q));
+                    if (it == edges.end()) continue;
+                    int springsOfEdge[2] = { it->second.structural, it->second.bending };
+                    for (int j = 0; j < 2; j++)
+                    {
+                        int s = springsOfEdge[j];
+                        if (s < 0) continue;
+                        if (springs[s].node1 == from) springs[s].node1 = &vertices[m];
+                        if (springs[s].node2 == from) springs[s].node2 = &vertices[m];
+                    }
+                }
+            }
+            // bending springs of edges not touching the moved vertex but with it as an opposite vertex
+            for (int i = 0; i < vertexTriangles[m].size(); i++)
+            {
+                int t = vertexTriangles[m][i];
+                for (int k = 0; k < 3; k++)
+                {
+                    int p = indices[3 * t + k], q = indices[3 * t + (k + 1) % 3];
+                    if (p == m || q == m) continue;
+                    auto it = edges.find(key(p, q));
+                    if (it == edges.end() || it->second.bending < 0) continue;
+                    Spring& s = springs[it->second.bending];
+                    if (s.node1 == from) s.node1 = &vertices[m];
+                    if (s.node2 == from) s.node2 = &vertices[m];
+                }
+            }
+            moved[last] = m;
+        }
+        vertices.pop_back();
+        rest.pop_back();
+        vertexOrigin.pop_back();
+        vertexSource.pop_back();
+        vertexTriangles.pop_back();
+    }
+};
+#endif
@@ -0,0 +1,94 @@
+#ifndef RENDER_VERTEX_H
+#define RENDER_VERTEX_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// What the GPU gets of a simulated vertex every frame: the position and the normal, octahedral encoded in
+// two 16 bit snorms and decoded in test.vs. That is 16 bytes in place of the 144 of a Vertex; the attributes
+// that do not move with the cloth (texture coordinates, tangents, bones) stay in a static buffer.
+struct RenderVertex {
+    glm::vec3 Position;
+    short Normal[2];
+};
+
+// The attributes of the static buffer, 64 bytes, uploaded only when the vertices are created or renumbered.
+struct StaticVertex {
+    glm::vec2 TexCoords;
+    glm::vec3 Tangent;
+    glm::vec3 Bitangent;
+    int m_BoneIDs[MAX_BONE_INFLUENCE];
+    float m_Weights[MAX_BONE_INFLUENCE];
+};
+
+// the unit sphere folded onto the octahedron |x| + |y| + |z| = 1, the lower half unfolded over the corners
+inline void OctahedralEncode(glm::vec3 n, short encoded[2])
+{
+    float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if (sum <= 0)
+    {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+    float x = n.x / sum, y = n.y / sum;
+    if (n.z < 0)
+    {
+        float fx = (1 - fabsf(y)) * (x >= 0 ? 1.0f : -1.0f);
+        float fy = (1 - fabsf(x)) * (y >= 0 ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    encoded[0] = (short)roundf(max(-1.0f, min(1.0f, x)) * 32767.0f);
+    encoded[1] = (short)roundf(max(-1.0f, min(1.0f, y)) * 32767.0f);
+}
+
+// the same as the shader does it
+inline glm::vec3 OctahedralDecode(const short encoded[2])
+{
+    glm::vec3 n(max(encoded[0] / 32767.0f, -1.0f), max(encoded[1] / 32767.0f, -1.0f), 0.0f);
+    n.z = 1 - fabsf(n.x) - fabsf(n.y);
+    if (n.z < 0)
+    {
+        float x = (1 - fabsf(n.y)) * (n.x >= 0 ? 1.0f : -1.0f);
+        float y = (1 - fabsf(n.x)) * (n.y >= 0 ? 1.0f : -1.0f);
+        n.x = x;
+        n.y = y;
+    }
+    return glm::normalize(n);
+}
+
+inline void PackRenderVertices(const vector<Vertex>& vertices, vector<RenderVertex>& packed)
+{
+    packed.resize(vertices.size());
+    ParallelFor(0, vertices.size(), [&](int i)
+        {
+            packed[i].Position = vertices[i].Position;
+            OctahedralEncode(vertices[i].Normal, packed[i].Normal);
+        }, 4096);
+}
+
+inline void PackStaticVertices(const vector<Vertex>& vertices, vector<StaticVertex>& packed)
+{
+    packed.resize(vertices.size());
+    ParallelFor(0, vertices.size(), [&](int i)
+        {
+            const Vertex& v = vertices[i];
+            StaticVertex& s = packed[i];
+            s.TexCoords = v.TexCoords;
+            s.Tangent = v.Tangent;
+            s.Bitangent = v.Bitangent;
+            for (int k = 0; k < MAX_BONE_INFLUENCE; k++)
+            {
+                s.m_BoneIDs[k] = v.m_BoneIDs[k];
+                s.m_Weights[k] = v.m_Weights[k];
+            }
+        }, 4096);
+}
+#endif
@@ -0,0 +1,107 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Topology.h"
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// Particle orderings for cache locality. Both return order[newIndex] = oldIndex.
+
+// Reverse Cuthill-McKee over the spring graph: a breadth first numbering from a low degree vertex, visiting
+// neighbours by increasing degree, then reversed. Connected particles end up with close indices, so the
+// bandwidth (largest index gap of an edge) stays around the width of the cloth.
+inline vector<int> ReverseCuthillMcKee(int vertexCount, const vector<Edge>& edges)
+{
+    vector<int> start(vertexCount + 1, 0), adjacent(2 * edges.size());
+    for (int i = 0; i < edges.size(); i++)
+    {
+        start[edges[i].firstVertex + 1]++;
+        start[edges[i].secondVertex + 1]++;
+    }
+    for (int v = 0; v < vertexCount; v++)
+        start[v + 1] += start[v];
+    vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < edges.size(); i++)
+    {
+        adjacent[fill[edges[i].firstVertex]++] = edges[i].secondVertex;
+        adjacent[fill[edges[i].secondVertex]++] = edges[i].firstVertex;
+    }
+    auto degree = [&](int v) { return start[v + 1] - start[v]; };
+
+    // seeds of the components by increasing degree, so every component starts at one of its boundary vertices
+    vector<int> seeds(vertexCount);
+    for (int v = 0; v < vertexCount; v++)
+        seeds[v] = v;
+    stable_sort(seeds.begin(), seeds.end(), [&](int a, int b) { return degree(a) < degree(b); });
+
+    vector<int> order;
+    order.reserve(vertexCount);
+    vector<char> visited(vertexCount, 0);
+    vector<int> next;
+    for (int s = 0; s < vertexCount; s++)
+    {
+        if (visited[seeds[s]]) continue;
+        visited[seeds[s]] = 1;
+        order.push_back(seeds[s]);
+        for (int head = order.size() - 1; head < order.size(); head++)
+        {
+            int v = order[head];
+            next.clear();
+            for (int k = start[v]; k < start[v + 1]; k++)
+                if (!visited[adjacent[k]])
+                {
+                    visited[adjacent[k]] = 1;
+                    next.push_back(adjacent[k]);
+                }
+            sort(next.begin(), next.end(), [&](int a, int b) { return degree(a) < degree(b) || (degree(a) == degree(b) && a < b); });
+            order.insert(order.end(), next.begin(), next.end());
+        }
+    }
+    reverse(order.begin(), order.end());
+    return order;
+}
+
+// spreads the low 10 bits of x to every third bit
+inline uint32_t MortonSpread(uint32_t x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8)) & 0x0300f00f;
+    x = (x | (x << 4)) & 0x030c30c3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+// Z-order curve through the rest positions, quantised to 1024 cells per axis of the bounding box. Needs no
+// connectivity and also keeps particles that are close in space but not connected (e.g. across a fold) close.
+inline vector<int> MortonOrder(const vector<Vertex>& vertices)
+{
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (int i = 0; i < vertices.size(); i++)
+    {
+        lo = glm::min(lo, vertices[i].Position);
+        hi = glm::max(hi, vertices[i].Position);
+    }
+    glm::vec3 extent = glm::max(hi - lo, glm::vec3(1e-12f));
+
+    vector<pair<uint32_t, int>> keys(vertices.size());
+    for (int i = 0; i < vertices.size(); i++)
+    {
+        glm::vec3 cell = (vertices[i].Position - lo) / extent * 1023.0f;
+        keys[i] = make_pair(MortonSpread((uint32_t)cell.x) | (MortonSpread((uint32_t)cell.y) << 1) | (MortonSpread((uint32_t)cell.z) << 2), i);
+    }
+    sort(keys.begin(), keys.end());
+
+    vector<int> order(vertices.size());
+    for (int i = 0; i < keys.size(); i++)
+        order[i] = keys[i].second;
+    return order;
+}
+#endif
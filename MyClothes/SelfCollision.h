@@ -0,0 +1,217 @@
+#ifndef SELF_COLLISION_H
+#define SELF_COLLISION_H
+
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+#include "Topology.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// Uniform grid hashed into a table of 2^k buckets, rebuilt every step with a counting sort:
+// bucket sizes are counted in parallel, prefix summed, then particles are scattered into place.
+class SpatialHash
+{
+public:
+    float cellSize = 1;
+    int tableSize = 0;
+    vector<int> cellStart;     // tableSize + 1 offsets into entries
+    vector<int> entries;       // particle indices grouped by bucket
+    vector<int> particleBucket;
+
+    void Build(const vector<Vertex>& vertices)
+    {
+        int n = vertices.size();
+        int size = 1;
+        while (size < 2 * n) size <<= 1;
+        if (size != tableSize)
+        {
+            tableSize = size;
+            counts.reset(new atomic<int>[tableSize]);
+        }
+        cellStart.resize(tableSize + 1);
+        entries.resize(n);
+        particleBucket.resize(n);
+
+        ParallelFor(0, tableSize, [&](int b) { counts[b].store(0, memory_order_relaxed); }, 4096);
+        ParallelFor(0, n, [&](int i)
+            {
+                int b = bucket(cellOf(vertices[i].Position));
+                particleBucket[i] = b;
+                counts[b].fetch_add(1, memory_order_relaxed);
+            }, 1024);
+
+        int sum = 0;
+        for (int b = 0; b < tableSize; b++)
+        {
+            cellStart[b] = sum;
+            sum += counts[b].load(memory_order_relaxed);
+            counts[b].store(cellStart[b], memory_order_relaxed);
+        }
+        cellStart[tableSize] = sum;
+
+        ParallelFor(0, n, [&](int i)
+            {
+                entries[counts[particleBucket[i]].fetch_add(1, memory_order_relaxed)] = i;
+            }, 1024);
+    }
+
+    glm::ivec3 cellOf(const glm::vec3& p) const
+    {
+        return glm::ivec3((int)floor(p.x / cellSize), (int)floor(p.y / cellSize), (int)floor(p.z / cellSize));
+    }
+
+    // large prime multipliers as in Teschner et al., "Optimized Spatial Hashing for Collision Detection of
+    // Deformable Objects", but x is added unscaled so cells adjacent along x land in adjacent buckets and a
+    // 27 cell query touches 9 runs of memory instead of 27 scattered ones
+    int bucket(const glm::ivec3& c) const
+    {
+        unsigned int h = (unsigned int)c.x + (unsigned int)c.y * 19349663u + (unsigned int)c.z * 83492791u;
+        return h & (tableSize - 1);
+    }
+
+    // calls visit(e) for every slot e of entries in the 27 cells around p; a bucket shared by two cells is visited once
+    template<typename F>
+    void Query(const glm::vec3& p, F visit) const
+    {
+        glm::ivec3 c = cellOf(p);
+        int seen[27];
+        int seenCount = 0;
+        for (int z = -1; z <= 1; z++)
+            for (int y = -1; y <= 1; y++)
+                for (int x = -1; x <= 1; x++)
+                {
+                    int b = bucket(c + glm::ivec3(x, y, z));
+                    bool duplicate = false;
+                    for (int k = 0; k < seenCount; k++)
+                        duplicate = duplicate || seen[k] == b;
+                    if (duplicate) continue;
+                    seen[seenCount++] = b;
+
+                    for (int e = cellStart[b]; e < cellStart[b + 1]; e++)
+                        visit(e);
+                }
+    }
+
+private:
+    unique_ptr<atomic<int>[]> counts;
+};
+
+// Particle-particle self collision: every particle is a sphere of radius thickness / 2, pairs that
+// are joined by a structural or bending spring are skipped. Each particle gathers its own push-out
+// from its neighbours (Jacobi style), so the response runs in parallel without atomics.
+class SelfCollision
+{
+public:
+    SpatialHash grid;
+    float thickness = 0;
+    float stiffness = 0.5f;
+    int contacts = 0;
+
+    // cell size follows the average edge length, thickness is clamped to it so 27 cells cover every pair
+    void SetTopology(int particleCount, const vector<Edge>& edges, const vector<Edge>& diagonals, float averageEdgeLength, float thicknessRatio = 0.5f)
+    {
+        grid.cellSize = averageEdgeLength;
+        thickness = min(thicknessRatio * averageEdgeLength, averageEdgeLength);
+
+        // CSR adjacency of the spring graph
+        adjacencyStart.assign(particleCount + 1, 0);
+        for (int i = 0; i < edges.size(); i++) { adjacencyStart[edges[i].firstVertex + 1]++; adjacencyStart[edges[i].secondVertex + 1]++; }
+        for (int i = 0; i < diagonals.size(); i++) { adjacencyStart[diagonals[i].firstVertex + 1]++; adjacencyStart[diagonals[i].secondVertex + 1]++; }
+        for (int i = 0; i < particleCount; i++)
+            adjacencyStart[i + 1] += adjacencyStart[i];
+
+        adjacency.resize(adjacencyStart[particleCount]);
+        vector<int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (int i = 0; i < edges.size(); i++) { adjacency[fill[edges[i].firstVertex]++] = edges[i].secondVertex; adjacency[fill[edges[i].secondVertex]++] = edges[i].firstVertex; }
+        for (int i = 0; i < diagonals.size(); i++) { adjacency[fill[diagonals[i].firstVertex]++] = diagonals[i].secondVertex; adjacency[fill[diagonals[i].secondVertex]++] = diagonals[i].firstVertex; }
+    }
+
+    void Resolve(vector<Vertex>& vertices)
+    {
+        int n = vertices.size();
+        if (n == 0 || adjacencyStart.size() != n + 1) return;
+
+        grid.Build(vertices);
+        // copy positions and velocities into bucket order so the neighbour loop reads contiguous memory
+        sortedPosition.resize(n);
+        sortedVelocity.resize(n);
+        sortedFixed.resize(n);
+        ParallelFor(0, n, [&](int e)
+            {
+                const Vertex& v = vertices[grid.entries[e]];
+                sortedPosition[e] = v.Position;
+                sortedVelocity[e] = v.velocity;
+                sortedFixed[e] = v.isFixed;
+            }, 2048);
+        positionDelta.resize(n);
+        velocityDelta.resize(n);
+        contactCount.resize(n);
+
+        ParallelFor(0, n, [&](int i)
+            {
+                const Vertex& vi = vertices[i];
+                glm::vec3 dp(0), dv(0);
+                int hits = 0;
+                grid.Query(vi.Position, [&](int e)
+                    {
+                        glm::vec3 d = vi.Position - sortedPosition[e];
+                        float dist2 = glm::dot(d, d);
+                        if (dist2 >= thickness * thickness || dist2 == 0) return;
+                        int j = grid.entries[e];
+                        if (adjacent(i, j)) return;
+
+                        float dist = sqrtf(dist2);
+                        glm::vec3 normal = d / dist;
+                        // split the overlap evenly, a fixed partner takes none of it
+                        float share = sortedFixed[e] ? 1.0f : 0.5f;
+                        dp += share * stiffness * (thickness - dist) * normal;
+
+                        float vn = glm::dot(vi.velocity - sortedVelocity[e], normal);
+                        if (vn < 0)
+                            dv -= share * vn * normal;
+                        hits++;
+                    });
+                positionDelta[i] = dp;
+                velocityDelta[i] = dv;
+                contactCount[i] = hits;
+            }, 512);
+
+        ParallelFor(0, n, [&](int i)
+            {
+                if (vertices[i].isFixed) return;
+                vertices[i].Position += positionDelta[i];
+                vertices[i].oldPos += positionDelta[i];
+                vertices[i].velocity += velocityDelta[i];
+            }, 2048);
+
+        contacts = 0;
+        for (int i = 0; i < n; i++)
+            contacts += contactCount[i];
+        contacts /= 2;
+    }
+
+private:
+    vector<int> adjacencyStart;
+    vector<int> adjacency;
+    vector<glm::vec3> sortedPosition;
+    vector<glm::vec3> sortedVelocity;
+    vector<char> sortedFixed;
+    vector<glm::vec3> positionDelta;
+    vector<glm::vec3> velocityDelta;
+    vector<int> contactCount;
+
+    bool adjacent(int i, int j) const
+    {
+        for (int k = adjacencyStart[i]; k < adjacencyStart[i + 1]; k++)
+            if (adjacency[k] == j) return true;
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,402 @@
+#ifndef SIGNED_DISTANCE_FIELD_H
+#define SIGNED_DISTANCE_FIELD_H
+
+#include <glm/glm.hpp>
+
+#include "Parallel.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+using namespace std;
+
+// cells per block edge; a block stores (SDF_BLOCK + 1)^3 nodes so a trilinear lookup never leaves its block
+#define SDF_BLOCK 8
+#define SDF_BLOCK_NODES ((SDF_BLOCK + 1) * (SDF_BLOCK + 1) * (SDF_BLOCK + 1))
+
+// closest point on triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5).
+// region reports the feature the point lies on: 0..2 vertex a/b/c, 3..5 edge ab/bc/ca, 6 face.
+inline glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, int& region)
+{
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ap = p - a;
+    float d1 = glm::dot(ab, ap);
+    float d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) { region = 0; return a; }
+
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp);
+    float d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) { region = 1; return b; }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        region = 3;
+        return a + ab * (d1 / (d1 - d3));
+    }
+
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp);
+    float d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) { region = 2; return c; }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        region = 5;
+        return a + ac * (d2 / (d2 - d6));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        region = 4;
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    region = 6;
+    return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Narrow band signed distance field on a sparse block grid. A dense table maps every block of the
+// bounding box to a brick of samples, or -1 when the block lies farther than the band from the surface,
+// so a query is one table read plus eight samples regardless of the triangle count of the source mesh.
+class SignedDistanceField
+{
+public:
+    glm::vec3 origin;
+    float cellSize = 0;
+    float bandWidth = 0;
+    glm::ivec3 blockDims;
+    vector<int> blockTable;
+    vector<float> bricks;
+    // bounds of the allocated band
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+
+    // bakes the field from a triangle soup; if cachePath is given a matching cache is loaded instead,
+    // and a freshly baked field is written there for next time
+    void Bake(const vector<glm::vec3>& positions, const vector<unsigned int>& indices, float cellSize, float bandWidth, const string& cachePath = "")
+    {
+        uint64_t key = hashInput(positions, indices, cellSize, bandWidth);
+        if (!cachePath.empty() && Load(cachePath, key))
+            return;
+
+        this->cellSize = cellSize;
+        this->bandWidth = bandWidth;
+        int triangleCount = indices.size() / 3;
+
+        glm::vec3 lo(INFINITY), hi(-INFINITY);
+        for (int i = 0; i < positions.size(); i++)
+        {
+            lo = glm::min(lo, positions[i]);
+            hi = glm::max(hi, positions[i]);
+        }
+        float pad = bandWidth + cellSize;
+        origin = lo - glm::vec3(pad);
+        glm::vec3 extent = (hi - lo) + glm::vec3(2 * pad);
+        float blockSize = cellSize * SDF_BLOCK;
+        blockDims = glm::ivec3((int)ceil(extent.x / blockSize), (int)ceil(extent.y / blockSize), (int)ceil(extent.z / blockSize));
+
+        // bin every triangle into the blocks its band overlaps
+        vector<vector<int>> blockTriangles(blockDims.x * blockDims.y * blockDims.z);
+        for (int t = 0; t < triangleCount; t++)
+        {
+            const glm::vec3& a = positions[indices[3 * t]];
+            const glm::vec3& b = positions[indices[3 * t + 1]];
+            const glm::vec3& c = positions[indices[3 * t + 2]];
+            glm::ivec3 b0 = blockOf(glm::min(a, glm::min(b, c)) - glm::vec3(bandWidth));
+            glm::ivec3 b1 = blockOf(glm::max(a, glm::max(b, c)) + glm::vec3(bandWidth));
+            for (int z = b0.z; z <= b1.z; z++)
+                for (int y = b0.y; y <= b1.y; y++)
+                    for (int x = b0.x; x <= b1.x; x++)
+                        blockTriangles[blockIndex(x, y, z)].push_back(t);
+        }
+
+        blockTable.assign(blockTriangles.size(), -1);
+        vector<int> allocated;
+        for (int i = 0; i < blockTriangles.size(); i++)
+        {
+            if (blockTriangles[i].empty()) continue;
+            blockTable[i] = allocated.size();
+            allocated.push_back(i);
+        }
+        bricks.assign(allocated.size() * SDF_BLOCK_NODES, bandWidth);
+
+        vector<glm::vec3> faceNormals, vertexNormals, edgeNormals;
+        pseudoNormals(positions, indices, faceNormals, vertexNormals, edgeNormals);
+
+        ParallelFor(0, allocated.size(), [&](int brick)
+            {
+                int block = allocated[brick];
+                glm::ivec3 blockCoord(block % blockDims.x, (block / blockDims.x) % blockDims.y, block / (blockDims.x * blockDims.y));
+                glm::vec3 blockOrigin = origin + glm::vec3(blockCoord) * blockSize;
+                const vector<int>& triangles = blockTriangles[block];
+                float* samples = &bricks[brick * SDF_BLOCK_NODES];
+
+                vector<float> best(SDF_BLOCK_NODES, INFINITY);
+                vector<float> sign(SDF_BLOCK_NODES, 1.0f);
+                auto consider = [&](int t, int n, const glm::vec3& p)
+                {
+                    int region;
+                    glm::vec3 d = p - ClosestPointOnTriangle(p, positions[indices[3 * t]], positions[indices[3 * t + 1]], positions[indices[3 * t + 2]], region);
+                    float dist2 = glm::dot(d, d);
+                    if (dist2 >= best[n]) return;
+
+                    // angle weighted pseudo normal of the closest feature gives a robust sign
+                    glm::vec3 normal;
+                    if (region < 3) normal = vertexNormals[indices[3 * t + region]];
+                    else if (region < 6) normal = edgeNormals[3 * t + region - 3];
+                    else normal = faceNormals[t];
+                    best[n] = dist2;
+                    sign[n] = glm::dot(d, normal) < 0 ? -1.0f : 1.0f;
+                };
+
+                // splat each triangle only into the nodes its band box covers
+                for (int k = 0; k < triangles.size(); k++)
+                {
+                    int t = triangles[k];
+                    const glm::vec3& a = positions[indices[3 * t]];
+                    const glm::vec3& b = positions[indices[3 * t + 1]];
+                    const glm::vec3& c = positions[indices[3 * t + 2]];
+                    glm::vec3 lo = (glm::min(a, glm::min(b, c)) - glm::vec3(bandWidth) - blockOrigin) / cellSize;
+                    glm::vec3 hi = (glm::max(a, glm::max(b, c)) + glm::vec3(bandWidth) - blockOrigin) / cellSize;
+                    glm::ivec3 n0 = glm::clamp(glm::ivec3((int)ceil(lo.x), (int)ceil(lo.y), (int)ceil(lo.z)), glm::ivec3(0), glm::ivec3(SDF_BLOCK));
+                    glm::ivec3 n1 = glm::clamp(glm::ivec3((int)floor(hi.x), (int)floor(hi.y), (int)floor(hi.z)), glm::ivec3(0), glm::ivec3(SDF_BLOCK));
+
+                    for (int z = n0.z; z <= n1.z; z++)
+                        for (int y = n0.y; y <= n1.y; y++)
+                            for (int x = n0.x; x <= n1.x; x++)
+                                consider(t, x + (SDF_BLOCK + 1) * (y + (SDF_BLOCK + 1) * z), blockOrigin + glm::vec3((float)x, (float)y, (float)z) * cellSize);
+                }
+
+                // A node no band box reached is farther than bandWidth from every triangle, so (with bandWidth at
+                // least cellSize) no surface passes between it and a neighbouring node: it takes the side of the
+                // reached nodes by a flood fill through the brick, rather than +bandWidth, which deep inside a
+                // thick mesh would make a false surface where it meets the negative nodes. A brick without a
+                // reached node gets the side of its first node from all of its triangles.
+                const int stride = SDF_BLOCK + 1;
+                vector<int> queue;
+                for (int n = 0; n < SDF_BLOCK_NODES; n++)
+                    if (best[n] < INFINITY) queue.push_back(n);
+                if (queue.empty())
+                {
+                    for (int k = 0; k < triangles.size(); k++)
+                        consider(triangles[k], 0, blockOrigin);
+                    queue.push_back(0);
+                }
+                for (int head = 0; head < queue.size(); head++)
+                {
+                    int n = queue[head];
+                    int x = n % stride, y = (n / stride) % stride, z = n / (stride * stride);
+                    int neighbours[6] = { x > 0 ? n - 1 : -1, x < SDF_BLOCK ? n + 1 : -1, y > 0 ? n - stride : -1,
+                        y < SDF_BLOCK ? n + stride : -1, z > 0 ? n - stride * stride : -1, z < SDF_BLOCK ? n + stride * stride : -1 };
+                    for (int k = 0; k < 6; k++)
+                    {
+                        int m = neighbours[k];
+                        if (m < 0 || best[m] < INFINITY) continue;
+                        best[m] = bandWidth * bandWidth;
+                        sign[m] = sign[n];
+                        queue.push_back(m);
+                    }
+                }
+                for (int n = 0; n < SDF_BLOCK_NODES; n++)
+                    samples[n] = sign[n] * min(sqrtf(best[n]), bandWidth);
+            }, 1);
+
+        boundsMin = glm::vec3(INFINITY);
+        boundsMax = glm::vec3(-INFINITY);
+        for (int i = 0; i < allocated.size(); i++)
+        {
+            int block = allocated[i];
+            glm::vec3 blockOrigin = origin + glm::vec3(glm::ivec3(block % blockDims.x, (block / blockDims.x) % blockDims.y, block / (blockDims.x * blockDims.y))) * blockSize;
+            boundsMin = glm::min(boundsMin, blockOrigin);
+            boundsMax = glm::max(boundsMax, blockOrigin + glm::vec3(blockSize));
+        }
+
+        if (!cachePath.empty())
+            Save(cachePath, key);
+    }
+
+    // trilinear distance and its gradient at p; false when p lies outside the narrow band
+    bool Sample(const glm::vec3& p, float& distance, glm::vec3& gradient) const
+    {
+        glm::vec3 g = (p - origin) / cellSize;
+        if (g.x < 0 || g.y < 0 || g.z < 0) return false;
+        int cx = (int)g.x, cy = (int)g.y, cz = (int)g.z;
+        int bx = cx / SDF_BLOCK, by = cy / SDF_BLOCK, bz = cz / SDF_BLOCK;
+        if (bx >= blockDims.x || by >= blockDims.y || bz >= blockDims.z) return false;
+        int brick = blockTable[blockIndex(bx, by, bz)];
+        if (brick < 0) return false;
+
+        const int sy = SDF_BLOCK + 1;
+        const int sz = sy * sy;
+        const float* s = &bricks[brick * SDF_BLOCK_NODES + (cx - bx * SDF_BLOCK) + (cy - by * SDF_BLOCK) * sy + (cz - bz * SDF_BLOCK) * sz];
+        float fx = g.x - cx, fy = g.y - cy, fz = g.z - cz;
+
+        float c000 = s[0], c100 = s[1], c010 = s[sy], c110 = s[sy + 1];
+        float c001 = s[sz], c101 = s[sz + 1], c011 = s[sz + sy], c111 = s[sz + sy + 1];
+
+        float c00 = c000 + (c100 - c000) * fx;
+        float c10 = c010 + (c110 - c010) * fx;
+        float c01 = c001 + (c101 - c001) * fx;
+        float c11 = c011 + (c111 - c011) * fx;
+        float c0 = c00 + (c10 - c00) * fy;
+        float c1 = c01 + (c11 - c01) * fy;
+        distance = c0 + (c1 - c0) * fz;
+
+        // derivative of the trilinear interpolant, in world units
+        float dx0 = (c100 - c000) + ((c110 - c010) - (c100 - c000)) * fy;
+        float dx1 = (c101 - c001) + ((c111 - c011) - (c101 - c001)) * fy;
+        gradient.x = (dx0 + (dx1 - dx0) * fz) / cellSize;
+        gradient.y = ((c10 - c00) + ((c11 - c01) - (c10 - c00)) * fz) / cellSize;
+        gradient.z = (c1 - c0) / cellSize;
+        return true;
+    }
+
+    // a lower bound of the distance to the surface where Sample has no value: every point within the band lies
+    // in an allocated brick, so an unallocated one is at least bandWidth away, and a point outside the bounds of
+    // the bricks is farther by its distance to them
+    float DistanceBound(const glm::vec3& p) const
+    {
+        glm::vec3 outside = glm::max(glm::max(boundsMin - p, p - boundsMax), glm::vec3(0));
+        return bandWidth + glm::length(outside);
+    }
+
+    bool Save(const string& path, uint64_t key) const
+    {
+        ofstream file(path, ios::binary);
+        if (!file)
+        {
+            cout << "ERROR::SDF::CANNOT_WRITE_CACHE: " << path << endl;
+            return false;
+        }
+        uint32_t magic = cacheMagic();
+        int allocatedCount = bricks.size() / SDF_BLOCK_NODES;
+        file.write((const char*)&magic, sizeof(magic));
+        file.write((const char*)&key, sizeof(key));
+        file.write((const char*)&origin, sizeof(origin));
+        file.write((const char*)&cellSize, sizeof(cellSize));
+        file.write((const char*)&bandWidth, sizeof(bandWidth));
+        file.write((const char*)&blockDims, sizeof(blockDims));
+        file.write((const char*)&boundsMin, sizeof(boundsMin));
+        file.write((const char*)&boundsMax, sizeof(boundsMax));
+        file.write((const char*)&allocatedCount, sizeof(allocatedCount));
+        file.write((const char*)blockTable.data(), blockTable.size() * sizeof(int));
+        file.write((const char*)bricks.data(), bricks.size() * sizeof(float));
+        return true;
+    }
+
+    // loads a cached field; fails when the file is missing or was baked from different input
+    bool Load(const string& path, uint64_t key)
+    {
+        ifstream file(path, ios::binary);
+        if (!file) return false;
+        uint32_t magic;
+        uint64_t fileKey;
+        int allocatedCount;
+        file.read((char*)&magic, sizeof(magic));
+        file.read((char*)&fileKey, sizeof(fileKey));
+        if (!file || magic != cacheMagic() || fileKey != key) return false;
+        file.read((char*)&origin, sizeof(origin));
+        file.read((char*)&cellSize, sizeof(cellSize));
+        file.read((char*)&bandWidth, sizeof(bandWidth));
+        file.read((char*)&blockDims, sizeof(blockDims));
+        file.read((char*)&boundsMin, sizeof(boundsMin));
+        file.read((char*)&boundsMax, sizeof(boundsMax));
+        file.read((char*)&allocatedCount, sizeof(allocatedCount));
+        if (!file) return false;
+        blockTable.resize(blockDims.x * blockDims.y * blockDims.z);
+        bricks.resize(allocatedCount * SDF_BLOCK_NODES);
+        file.read((char*)blockTable.data(), blockTable.size() * sizeof(int));
+        file.read((char*)bricks.data(), bricks.size() * sizeof(float));
+        return (bool)file;
+    }
+
+private:
+    static uint32_t cacheMagic()
+    {
+        return 0x32464453; // "SDF2", fields of "SDF1" could hold unsigned nodes
+    }
+
+    int blockIndex(int x, int y, int z) const
+    {
+        return x + blockDims.x * (y + blockDims.y * z);
+    }
+
+    glm::ivec3 blockOf(const glm::vec3& p) const
+    {
+        glm::vec3 g = (p - origin) / (cellSize * SDF_BLOCK);
+        return glm::clamp(glm::ivec3((int)floor(g.x), (int)floor(g.y), (int)floor(g.z)), glm::ivec3(0), blockDims - glm::ivec3(1));
+    }
+
+    // FNV-1a over the input mesh and bake parameters, used to validate the disk cache
+    static uint64_t hashInput(const vector<glm::vec3>& positions, const vector<unsigned int>& indices, float cellSize, float bandWidth)
+    {
+        uint64_t h = 14695981039346656037ull;
+        auto mix = [&h](const void* data, size_t size)
+        {
+            const unsigned char* bytes = (const unsigned char*)data;
+            for (size_t i = 0; i < size; i++)
+            {
+                h ^= bytes[i];
+                h *= 1099511628211ull;
+            }
+        };
+        if (!positions.empty()) mix(positions.data(), positions.size() * sizeof(glm::vec3));
+        if (!indices.empty()) mix(indices.data(), indices.size() * sizeof(unsigned int));
+        mix(&cellSize, sizeof(cellSize));
+        mix(&bandWidth, sizeof(bandWidth));
+        return h;
+    }
+
+    // face, angle weighted vertex and edge normals (Baerentzen & Aanaes) for the inside/outside test
+    static void pseudoNormals(const vector<glm::vec3>& positions, const vector<unsigned int>& indices,
+        vector<glm::vec3>& faceNormals, vector<glm::vec3>& vertexNormals, vector<glm::vec3>& edgeNormals)
+    {
+        int triangleCount = indices.size() / 3;
+        faceNormals.assign(triangleCount, glm::vec3(0));
+        vertexNormals.assign(positions.size(), glm::vec3(0));
+        edgeNormals.assign(3 * triangleCount, glm::vec3(0));
+        unordered_map<uint64_t, glm::vec3> edgeSum;
+
+        for (int t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 n = glm::cross(positions[indices[3 * t + 1]] - positions[indices[3 * t]], positions[indices[3 * t + 2]] - positions[indices[3 * t]]);
+            float len = glm::length(n);
+            if (len > 0) n /= len;
+            faceNormals[t] = n;
+
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v0 = indices[3 * t + k];
+                unsigned int v1 = indices[3 * t + (k + 1) % 3];
+                unsigned int v2 = indices[3 * t + (k + 2) % 3];
+                glm::vec3 e1 = positions[v1] - positions[v0];
+                glm::vec3 e2 = positions[v2] - positions[v0];
+                float l1 = glm::length(e1), l2 = glm::length(e2);
+                if (l1 > 0 && l2 > 0)
+                    vertexNormals[v0] += acosf(glm::clamp(glm::dot(e1, e2) / (l1 * l2), -1.0f, 1.0f)) * n;
+                edgeSum[edgeKey(v0, v1)] += n;
+            }
+        }
+        for (int t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+                edgeNormals[3 * t + k] = edgeSum[edgeKey(indices[3 * t + k], indices[3 * t + (k + 1) % 3])];
+    }
+
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        if (a > b) swap(a, b);
+        return ((uint64_t)a << 32) | b;
+    }
+};
+#endif
@@ -0,0 +1,94 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <thread>
+#include <atomic>
+#include <functional>
+using namespace std;
+
+// Hands the latest complete value from one writer thread to one reader thread without either of them ever
+// waiting. There are three slots: the writer fills its back slot and swaps it with the middle one, the reader
+// swaps its front slot with the middle one when that holds something newer. Both swaps are a single atomic
+// exchange of a slot index, so a slow side only ever sees a less recent value, never a torn one. Values the
+// reader did not get to in time are overwritten; the slots keep their allocations, so refilling a slot with
+// vectors of the same size does not allocate.
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+    {
+        middle = 2;
+    }
+
+    // the slot the writer fills, untouched by the reader until Publish
+    T& Back()
+    {
+        return slots[back];
+    }
+
+    void Publish()
+    {
+        back = middle.exchange(back | fresh) & ~fresh;
+    }
+
+    // true when a newer value has been published since the last call; Front then returns it
+    bool Update()
+    {
+        if (!(middle.load() & fresh)) return false;
+        front = middle.exchange(front) & ~fresh;
+        return true;
+    }
+
+    const T& Front() const
+    {
+        return slots[front];
+    }
+
+private:
+    static const int fresh = 4;     // set on the middle index while the reader has not taken it
+    T slots[3];
+    int back = 0;
+    int front = 1;
+    atomic<int> middle;
+};
+
+// Runs a step function over and over on a thread of its own until stopped, e.g. the simulation while the
+// main thread keeps rendering at the display rate. Whatever the step shares with other threads goes through
+// TripleBuffers.
+class SimulationThread
+{
+public:
+    ~SimulationThread()
+    {
+        Stop();
+    }
+
+    void Start(const function<void()>& step)
+    {
+        Stop();
+        running = true;
+        worker = thread([this, step]()
+            {
+                while (running.load())
+                    step();
+            });
+    }
+
+    // lets the current step finish
+    void Stop()
+    {
+        running = false;
+        if (worker.joinable()) worker.join();
+    }
+
+    bool Running() const
+    {
+        return running.load();
+    }
+
+private:
+    thread worker;
+    atomic<bool> running{ false };
+};
+#endif
@@ -1,6 +1,9 @@
+#ifndef SPRING_H
+#define SPRING_H
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include "mesh.h"
+#include "Vertex.h"
 
 class Spring
 {
@@ -14,4 +17,5 @@ public:
 	float originLength;
 	float hookC;		// hook coefficient
 	float dampC;		// damp coefficient
-};
\ No newline at end of file
+};
+#endif
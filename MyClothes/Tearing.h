@@ -0,0 +1,276 @@
+#ifndef TEARING_H
+#define TEARING_H
+
+#include <glm/glm.hpp>
+
+#include "IncrementalMesh.h"
+#include "Parallel.h"
+
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// Tearing of a single cloth mesh. A structural spring stretched past tearStrain tears its edge: the bending
+// spring across it goes and the two triangles stop holding each other. Around each end point the triangles
+// are then grouped into fans that are still joined through untorn edges; when there is more than one, the
+// particle is duplicated for every further fan, so a crack opens as soon as it reaches the boundary or meets
+// another torn edge. Each tear edits the index buffer, the springs and the edge, bending and triangle pair
+// lists in place and only visits the triangles around its two end points, so a tear costs the same on a
+// mesh of any size. Duplicated particles keep their rest position, the vertex array needs capacity for them.
+class ClothTearing : public IncrementalMesh
+{
+public:
+    float tearStrain = 0.6f;        // relative stretch of a structural spring at which its edge tears
+    int maxTearsPerStep = 32;       // the most strained edges first, the rest wait for the next call
+    int tears = 0;                  // edges torn by the last call
+    int separated = 0;              // particles duplicated by the last call
+    int totalTears = 0;
+    float tearMs = 0;
+    vector<int> changedTriangles;   // triangles renumbered by the last call
+
+    // takes over the springs like IncrementalMesh::Setup and fills the lists it keeps up to date afterwards
+    void Setup(vector<Vertex>& vertices, const vector<unsigned int>& indices, vector<Spring>& springs, float structural, float bending, float damping,
+        vector<Edge>& edgeList, vector<Edge>& diagonals, vector<Neighbour>& neighbours)
+    {
+        IncrementalMesh::Setup(vertices, indices, springs, structural, bending, damping);
+        edgeList.clear();
+        diagonals.clear();
+        neighbours.clear();
+        edgeKeys.clear();
+        pairKeys.clear();
+        edgeSlot.clear();
+        pairSlot.clear();
+        for (auto it = edges.begin(); it != edges.end(); ++it)
+        {
+            listEdge(edgeList, it->first);
+            if (it->second.triangle[1] >= 0) listPair(indices, diagonals, neighbours, it->first);
+        }
+        totalTears = 0;
+    }
+
+    // tears the edges strained past tearStrain; true when the topology changed
+    bool Tear(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs,
+        vector<Edge>& edgeList, vector<Edge>& diagonals, vector<Neighbour>& neighbours)
+    {
+        auto t0 = chrono::steady_clock::now();
+        tears = separated = 0;
+        changedTriangles.clear();
+        beginEdit(vertices.size());
+
+        strain.resize(springs.size());
+        ParallelFor(0, springs.size(), [&](int s)
+            {
+                const Spring& spring = springs[s];
+                strain[s] = springBending[s] ? 0.0f : glm::length(spring.node1->Position - spring.node2->Position) / spring.originLength - 1.0f;
+            }, 4096);
+        candidates.clear();
+        for (int s = 0; s < springs.size(); s++)
+            if (strain[s] > tearStrain) candidates.push_back(make_pair(strain[s], springKeys[s]));
+        sort(candidates.begin(), candidates.end(), [](const pair<float, uint64_t>& a, const pair<float, uint64_t>& b) { return a.first > b.first; });
+
+        for (int i = 0; i < candidates.size() && tears < maxTearsPerStep; i++)
+            if (tear(vertices, indices, springs, edgeList, diagonals, neighbours, candidates[i].second)) tears++;
+        totalTears += tears;
+        tearMs = chrono::duration<float, milli>(chrono::steady_clock::now() - t0).count();
+        return tears > 0;
+    }
+
+private:
+    vector<uint64_t> edgeKeys;          // edge of every entry of the edge list
+    vector<uint64_t> pairKeys;          // edge of every entry of the bending and triangle pair lists
+    unordered_map<uint64_t, int> edgeSlot;
+    unordered_map<uint64_t, int> pairSlot;
+    vector<float> strain;
+    vector<pair<float, uint64_t>> candidates;
+
+    bool tear(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs,
+        vector<Edge>& edgeList, vector<Edge>& diagonals, vector<Neighbour>& neighbours, uint64_t k)
+    {
+        // an earlier tear of this call may have renamed the edge; it is found again next time
+        auto it = edges.find(k);
+        if (it == edges.end() || it->second.triangle[1] < 0 || it->second.torn) return false;
+        it->second.torn = true;
+        updateBending(vertices, indices, springs, k);
+        unlistPair(diagonals, neighbours, k);
+
+        int a = first(k), b = second(k);
+        separate(vertices, indices, springs, edgeList, diagonals, a);
+        separate(vertices, indices, springs, edgeList, diagonals, b);
+        return true;
+    }
+
+    // splits the triangles around v into fans joined through untorn edges, every fan but the first gets a copy of v
+    void separate(vector<Vertex>& vertices, vector<unsigned int>& indices, vector<Spring>& springs,
+        vector<Edge>& edgeList, vector<Edge>& diagonals, int v)
+    {
+        const vector<int> around = vertexTriangles[v];
+        vector<int> fan(around.size(), -1);
+        int fans = 0;
+        vector<int> stack;
+        for (int i = 0; i < around.size(); i++)
+        {
+            if (fan[i] >= 0) continue;
+            fan[i] = fans;
+            stack.push_back(i);
+            while (!stack.empty())
+            {
+                int t = around[stack.back()];
+                stack.pop_back();
+                for (int c = 0; c < 3; c++)
+                {
+                    int x = indices[3 * t + c];
+                    if (x == v) continue;
+                    auto it = edges.find(key(v, x));
+                    if (it == edges.end() || it->second.torn || it->second.triangle[1] < 0) continue;
+                    int u = it->second.triangle[0] == t ? it->second.triangle[1] : it->second.triangle[0];
+                    int j = find(around.begin(), around.end(), u) - around.begin();
+                    if (j < around.size() && fan[j] < 0)
+                    {
+                        fan[j] = fans;
+                        stack.push_back(j);
+                    }
+                }
+            }
+            fans++;
+        }
+
+        for (int f = 1; f < fans; f++)
+        {
+            if (vertices.size() >= vertices.capacity()) return;
+            int w = vertices.size();
+            vertices.push_back(vertices[v]);
+            rest.push_back(rest[v]);
+            vertexOrigin.push_back(vertexOrigin[v]);
+            vertexSource.push_back(-1);
+            vertexTriangles.push_back(vector<int>());
+            separated++;
+
+            vector<int> moving;
+            for (int i = 0; i < around.size(); i++)
+                if (fan[i] == f) moving.push_back(around[i]);
+            vector<int> spokes;
+            for (int i = 0; i < moving.size(); i++)
+            {
+                int t = moving[i];
+                replaceVertex(indices, t, v, w);
+                eraseValue(vertexTriangles[v], t);
+                vertexTriangles[w].push_back(t);
+                changedTriangles.push_back(t);
+                for (int c = 0; c < 3; c++)
+                {
+                    int x = indices[3 * t + c];
+                    if (x != w && find(spokes.begin(), spokes.end(), x) == spokes.end()) spokes.push_back(x);
+                }
+            }
+
+            for (int i = 0; i < spokes.size(); i++)
+            {
+                int x = spokes[i];
+                uint64_t from = key(v, x), to = key(w, x);
+                auto it = edges.find(from);
+                if (it == edges.end()) continue;
+                MeshEdge e = it->second;
+                bool in0 = find(moving.begin(), moving.end(), e.triangle[0]) != moving.end();
+                bool in1 = e.triangle[1] >= 0 && find(moving.begin(), moving.end(), e.triangle[1]) != moving.end();
+                if (in0 != in1 && e.triangle[1] >= 0)
+                {
+                    // a torn edge between this fan and the rest: both sides become boundary edges with a spring each
+                    int moved = in0 ? e.triangle[0] : e.triangle[1];
+                    it->second.triangle[0] = in0 ? e.triangle[1] : e.triangle[0];
+                    it->second.triangle[1] = -1;
+                    it->second.torn = false;
+                    MeshEdge side = { { moved, -1 }, -1, -1, false };
+                    edges[to] = side;
+                    edges[to].structural = addSpring(vertices, springs, w, x, to, false);
+                    listEdge(edgeList, to);
+                    continue;
+                }
+                // the edge goes along with the fan
+                edges.erase(it);
+                edges[to] = e;
+                springKeys[e.structural] = to;
+                if (e.bending >= 0) springKeys[e.bending] = to;
+                bindSpring(vertices, springs, e.structural, w, x);
+                rekey(edgeKeys, edgeSlot, from, to);
+                edgeList[edgeSlot[to]].firstVertex = first(to);
+                edgeList[edgeSlot[to]].secondVertex = second(to);
+                rekey(pairKeys, pairSlot, from, to);
+            }
+
+            // bending springs that reached v from across the far edges of the moved triangles
+            for (int i = 0; i < moving.size(); i++)
+            {
+                int t = moving[i];
+                for (int c = 0; c < 3; c++)
+                {
+                    int p = indices[3 * t + c], q = indices[3 * t + (c + 1) % 3];
+                    if (p == w || q == w) continue;
+                    updateBending(vertices, indices, springs, key(p, q));
+                    refreshPair(indices, diagonals, key(p, q));
+                }
+            }
+        }
+    }
+
+    void listEdge(vector<Edge>& edgeList, uint64_t k)
+    {
+        Edge e = { first(k), second(k) };
+        edgeSlot[k] = edgeList.size();
+        edgeKeys.push_back(k);
+        edgeList.push_back(e);
+    }
+
+    void listPair(const vector<unsigned int>& indices, vector<Edge>& diagonals, vector<Neighbour>& neighbours, uint64_t k)
+    {
+        const MeshEdge& edge = edges[k];
+        Edge d = { opposite(indices, edge.triangle[0], first(k), second(k)), opposite(indices, edge.triangle[1], first(k), second(k)) };
+        Neighbour pair = { edge.triangle[0], edge.triangle[1] };
+        pairSlot[k] = diagonals.size();
+        pairKeys.push_back(k);
+        diagonals.push_back(d);
+        neighbours.push_back(pair);
+    }
+
+    // swap and pop, like the springs
+    void unlistPair(vector<Edge>& diagonals, vector<Neighbour>& neighbours, uint64_t k)
+    {
+        auto it = pairSlot.find(k);
+        if (it == pairSlot.end()) return;
+        int slot = it->second, last = diagonals.size() - 1;
+        pairSlot.erase(it);
+        if (slot != last)
+        {
+            diagonals[slot] = diagonals[last];
+            neighbours[slot] = neighbours[last];
+            pairKeys[slot] = pairKeys[last];
+            pairSlot[pairKeys[slot]] = slot;
+        }
+        diagonals.pop_back();
+        neighbours.pop_back();
+        pairKeys.pop_back();
+    }
+
+    void refreshPair(const vector<unsigned int>& indices, vector<Edge>& diagonals, uint64_t k)
+    {
+        auto it = pairSlot.find(k);
+        if (it == pairSlot.end()) return;
+        const MeshEdge& edge = edges[k];
+        diagonals[it->second].firstVertex = opposite(indices, edge.triangle[0], first(k), second(k));
+        diagonals[it->second].secondVertex = opposite(indices, edge.triangle[1], first(k), second(k));
+    }
+
+    static void rekey(vector<uint64_t>& keys, unordered_map<uint64_t, int>& slots, uint64_t from, uint64_t to)
+    {
+        auto it = slots.find(from);
+        if (it == slots.end()) return;
+        int slot = it->second;
+        slots.erase(it);
+        slots[to] = slot;
+        keys[slot] = to;
+    }
+};
+#endif
@@ -0,0 +1,38 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+struct Triple
+{
+    int firstVertex;
+    int secondVertex;
+    int faceIndex;
+};
+
+struct Edge
+{
+    int firstVertex;
+    int secondVertex;
+};
+
+struct Neighbour 
+{
+    int firstTriangle;
+    int secondTriangle;
+};
+
+// the part of the shared particle pool, index buffer, topology lists and springs that belongs to one cloth
+struct ClothRange
+{
+    int firstParticle;
+    int particleCount;
+    int firstTriangle;
+    int triangleCount;
+    int firstEdge;
+    int edgeCount;
+    int firstDiagonal;      // also the first of its triangle pairs
+    int diagonalCount;
+    int firstSpring;
+    int springCount;
+    int anchors[2];         // pool particles SimulateCorners pins, -1 for none
+};
+#endif
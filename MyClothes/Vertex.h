@@ -0,0 +1,38 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include <glm/glm.hpp>
+
+#define MAX_BONE_INFLUENCE 4
+
+// A particle of the cloth and a vertex of its render mesh at once: the GL attribute layout of Mesh comes
+// first, the physics state after it. Kept apart from mesh.h so the simulation headers need no GL.
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    //Physics
+    //Physics physic;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+    //bone indexes which will influence this vertex
+    int m_BoneIDs[MAX_BONE_INFLUENCE];
+    //weights from each bone
+    float m_Weights[MAX_BONE_INFLUENCE];
+
+    // physics
+    float mass;
+    glm::vec3 velocity;
+    glm::vec3 acceleration;
+    glm::vec3 force;
+
+    glm::vec3 oldPos;
+
+    bool isFixed;
+};
+#endif
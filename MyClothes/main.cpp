@@ -5,13 +5,20 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "shader.h"
+#include "FrameUniforms.h"
 #include "Camera.h"
 #include "model.h"
+#include "ModelRenderer.h"
+#include "BatchSimulator.h"
+#include "ClothCrowd.h"
+#include "SimulationThread.h"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -34,18 +41,168 @@ double gravitySimTime;
 float springTime;
 float holderSimTime;
 float windSimTime;
-float ballTime;
-float frictionTime;
 float cornerTime;
+float selfCollisionTime;
+float ccdTime;
 
 
 float radian = 0.8f;
+// simulation step
+float timeStep = 0.0016f;
+float animationTime = 0.0f;
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+// what the UI controls; the simulation steps with its own copy
+struct SimulationSettings {
+    bool useWind = false;
+    bool useCorner = false;
+    bool useBallTest = false;
+    bool useFriction = false;
+    bool useBody = true;
+    bool useSelfCollision = false;
+    bool useCCD = false;
+    bool useMovingBall = false;
+    bool useProjective = false;
+    bool normalConeCulling = false;
+    int substeps = 1;               // steps per rendered frame
+    int projectiveIterations = 4;
+    int projectiveCycles = 1;
+    int remeshInterval = 1;
+    float tearStrain = 0.6f;
+    int writeRequests = 0;          // presses of the write button
+};
+
+// what the UI shows of the simulation
+struct SimulationStats {
+    float stepMs;
+    int contacts;
+    int matched;
+    int broadPhasePairs;
+    int clothPairs;
+    BVHStats bvh;
+    int ccdImpacts;
+    int ccdIterations;
+    int zoneCount;
+    int largestZone;
+    int zoneIterations;
+    int levels;
+    float residual;
+    int particles;
+    int splits;
+    int collapses;
+    int flips;
+    float planMs;
+    int totalTears;
+    float tearMs;
+};
+
+// a finished frame as the renderer needs it
+struct SimulationFrame {
+    vector<vector<Vertex>> vertices;        // of every drawn mesh
+    vector<vector<unsigned int>> indices;
+    int topology = -1;                      // topologyVersion of the indices
+    SimulationStats stats;
+};
+
+void simulateFrame(Model& ourModel, Model& renderModel, const SimulationSettings& settings, int ballCollider, int bodyCollider, int& frameCount, int& writesDone);
+void captureStats(const Model& ourModel, SimulationStats& stats);
+void captureFrame(const Model& ourModel, const Model& renderModel, SimulationFrame& frame);
+void makeBatch(int count, int clothResolution, bool circularCloth, ClothBatch& batch, ClothGrid& clothGrid);
+
+int main(int argc, char** argv)
 {
+    // --grid N or --circle N replaces the 10x10 pattern by a generated cloth of N x N quads, e.g. for scaling runs
+    // --cloths N hangs N of the generated cloths side by side, all simulated together
+    // --reorder rcm or --reorder morton renumbers the particles for locality before the springs are made
+    // --render file.obj draws that (finer) mesh, embedded in the simulated cloth, in place of the cloth itself
+    // --body file.obj adds that mesh as a collider, e.g. ./resources/body/body.obj
+    // --remesh N refines the cloth adaptively where it wrinkles, up to N particles
+    // --tear N lets the cloth tear where it is overstretched, up to N particles
+    // --simulation inline steps the simulation between the rendered frames instead of on a thread of its own
+    // --batch N steps N variants of the generated cloth for --frames F frames without a window and reports the throughput
+    // --crowd N hangs the same N variants behind the cloth, simulated as a batch and drawn with a single call
+    const char* renderPath = NULL;
+    const char* bodyPath = NULL;
+    int remeshBudget = 0;
+    int tearBudget = 0;
+    int clothResolution = 0;
+    int clothCount = 1;
+    int batchCount = 0;
+    int batchFrames = 600;
+    int crowdCount = 0;
+    bool circularCloth = false;
+    bool reorderParticles = false;
+    bool mortonOrder = false;
+    bool simulationThread = true;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--grid") == 0 || strcmp(argv[i], "--circle") == 0)
+        {
+            circularCloth = strcmp(argv[i], "--circle") == 0;
+            clothResolution = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cloths") == 0)
+        {
+            clothCount = max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--render") == 0)
+        {
+            renderPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--body") == 0)
+        {
+            bodyPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--reorder") == 0)
+        {
+            reorderParticles = true;
+            mortonOrder = strcmp(argv[++i], "morton") == 0;
+        }
+        else if (strcmp(argv[i], "--remesh") == 0)
+        {
+            remeshBudget = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--tear") == 0)
+        {
+            tearBudget = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--simulation") == 0)
+        {
+            simulationThread = strcmp(argv[++i], "inline") != 0;
+        }
+        else if (strcmp(argv[i], "--batch") == 0)
+        {
+            batchCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--frames") == 0)
+        {
+            batchFrames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--crowd") == 0)
+        {
+            crowdCount = atoi(argv[++i]);
+        }
+    }
+
+    if (batchCount > 0)
+    {
+        ClothBatch batch;
+        ClothGrid clothGrid;
+        makeBatch(batchCount, clothResolution, circularCloth, batch, clothGrid);
+        float total = 0;
+        for (int frame = 0; frame < batchFrames; frame++)
+        {
+            batch.Step(timeStep);
+            total += batch.stepMs;
+        }
+        cout << batchCount << " instances of " << clothGrid.vertices.size() << " particles, " << batchFrames << " frames on "
+            << ThreadPool::Get().Size() << " threads: " << total << " ms, "
+            << (total > 0 ? batch.instanceSteps * 1000.0 / total : 0.0) << " instance steps/s" << endl;
+        return 0;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -99,15 +256,86 @@ int main()
     Shader planeShader("./Shader/light_Vertex.glsl", "./Shader/light_Fragment.glsl");
     Shader clothShader("./Shader/test.vs", "./Shader/test.fs");
 
-    Model ourModel("./resources/nanosuit/10x10.obj");
-    ourModel.read();
-    ourModel.vertexSort();
+    Model ourModel;
+    if (clothResolution > 0)
+    {
+        ClothGrid clothGrid;
+        double start = glfwGetTime();
+        if (circularCloth)
+            ClothGenerator::Circle(clothResolution, 1.0f, clothGrid);
+        else
+            ClothGenerator::Rectangle(clothResolution, clothResolution, 2.0f, 2.0f, clothGrid);
+        cout << "Generated " << clothGrid.vertices.size() << " vertices, " << clothGrid.indices.size() / 3 << " triangles in "
+            << (glfwGetTime() - start) * 1000.0 << " ms" << endl;
+        ClothGrid first = clothGrid;
+        ourModel.LoadCloth(first);
+        for (int c = 1; c < clothCount; c++)
+        {
+            ClothGrid copy = clothGrid;
+            ourModel.AddCloth(copy, glm::vec3(2.5f * c, 0.0f, 0.0f));
+        }
+    }
+    else
+    {
+        ourModel.Load("./resources/nanosuit/10x10.obj");
+        ourModel.read();
+        ourModel.vertexSort();
+        // the two top corners of the pattern
+        ourModel.cloths[0].anchors[0] = 100;
+        ourModel.cloths[0].anchors[1] = 120;
+    }
+    if (reorderParticles)
+        ourModel.ReorderParticles(mortonOrder);
     ourModel.CreateSpring();
+    ourModel.SetupSelfCollision();
+    ourModel.SetupProjective();
 
-    bool useWind = false;
-    bool useCorner = false;
-    bool useBallTest = false;
-    bool useFriction = false;
+    Model renderModel;
+    if (renderPath)
+    {
+        renderModel.Load(renderPath);
+        ourModel.Embed(renderModel);
+    }
+    bool useEmbedding = !renderModel.meshes.empty();
+    // the embedding is bound to the triangles of the cloth, so it cannot follow a remeshed or torn one
+    if (remeshBudget > 0 && !useEmbedding)
+        ourModel.SetupRemeshing(remeshBudget);
+    else if (tearBudget > 0 && !useEmbedding)
+        ourModel.SetupTearing(tearBudget);
+    int frameCount = 0;
+    int writesDone = 0;
+
+    // ground plane (drawn at y = -10.5) and the test ball
+    ourModel.colliders.AddPlane(glm::vec3(0.0f, -10.5f, 0.0f), glm::vec3(0, 1, 0));
+    int ballCollider = ourModel.colliders.AddSphere(glm::vec3(0.0f, -9.5f, 0.0f), 0.75f);
+    // the moving ball test sweeps it from side to side under the cloth
+    ourModel.colliders.AddKeyframe(ballCollider, 0.0f, glm::vec3(0.0f));
+    ourModel.colliders.AddKeyframe(ballCollider, 0.4f, glm::vec3(1.5f, 0.0f, 0.0f));
+    ourModel.colliders.AddKeyframe(ballCollider, 1.2f, glm::vec3(-1.5f, 0.0f, 0.0f));
+    ourModel.colliders.AddKeyframe(ballCollider, 1.6f, glm::vec3(0.0f));
+
+    // optional body collider, baked into a narrow band distance field that is cached next to the mesh
+    Model bodyModel;
+    SignedDistanceField bodyField;
+    int bodyCollider = -1;
+    if (bodyPath)
+        bodyModel.Load(bodyPath);
+    if (!bodyModel.meshes.empty())
+    {
+        vector<glm::vec3> bodyPositions;
+        vector<unsigned int> bodyIndices;
+        bodyModel.CollectTriangles(bodyPositions, bodyIndices);
+        bodyField.Bake(bodyPositions, bodyIndices, 0.01f, 0.05f, string(bodyPath) + ".sdf");
+        bodyCollider = ourModel.colliders.AddField(&bodyField);
+    }
+
+    SimulationSettings settings;
+    settings.normalConeCulling = ourModel.clothBVH.normalConeCulling;
+    settings.projectiveIterations = ourModel.projective.iterations;
+    settings.projectiveCycles = ourModel.projective.cycles;
+    settings.remeshInterval = ourModel.remesher.interval;
+    settings.tearStrain = ourModel.tearing.tearStrain;
+    SimulationStats stats = {};
 
     float planeVertices[] = {
         // positions          // texture 
@@ -141,15 +369,85 @@ int main()
     planeShader.use();
     planeShader.setInt("material.diffuse", 0);
     planeShader.setInt("material.specular", 1);
+    planeShader.setFloat("material.shininess", 32.0f);
 
     clothShader.use();
     clothShader.setInt("material.diffuse", 0);
+    clothShader.setFloat("material.shininess", 32.0f);
+
+    // camera and light go to both programs through one uniform buffer; only the model matrix is per program
+    FrameUniformBuffer frameUniforms;
+    frameUniforms.Create();
+    frameUniforms.Attach(clothShader);
+    frameUniforms.Attach(planeShader);
+    FrameUniforms frame;
+    frame.lightDirection = glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f);
+    frame.lightAmbient = glm::vec4(0.25f, 0.25f, 0.25f, 0.0f);
+    frame.lightDiffuse = glm::vec4(0.6f, 0.6f, 0.6f, 0.0f);
+    frame.lightSpecular = glm::vec4(0.8f, 0.8f, 0.8f, 0.0f);
+    int clothModelUniform = clothShader.Uniform("model");
+    int planeModelUniform = planeShader.Uniform("model");
+
+    // the crowd, in rows of up to ceil(sqrt(N)) cloths behind the simulated one
+    ClothBatch crowdBatch;
+    ClothCrowd crowd;
+    if (crowdCount > 0)
+    {
+        ClothGrid crowdGrid;
+        makeBatch(crowdCount, clothResolution, circularCloth, crowdBatch, crowdGrid);
+        int columns = (int)ceil(sqrt((float)crowdCount));
+        vector<glm::vec3> offsets(crowdCount);
+        for (int b = 0; b < crowdCount; b++)
+            offsets[b] = glm::vec3(2.5f * (b % columns - 0.5f * (columns - 1)), 0.0f, -2.5f * (b / columns + 1));
+        crowd.Setup(crowdGrid.vertices, crowdGrid.indices, offsets);
+    }
+    // the crowd is stepped and packed next to the simulation, one batch frame per simulation frame, and
+    // reaches the render loop like the simulated cloth does
+    TripleBuffer<CrowdFrame> crowdFrames;
+    auto stepCrowd = [&]()
+    {
+        if (crowd.InstanceCount() == 0) return;
+        crowdBatch.Step(timeStep);
+        CrowdFrame& packed = crowdFrames.Back();
+        crowd.Pack(crowdBatch, packed);
+        packed.stepMs = crowdBatch.stepMs;
+        crowdFrames.Publish();
+    };
+
+    // the GL side of what is drawn; the models themselves are only simulated
+    Model& drawnModel = useEmbedding ? renderModel : ourModel;
+    ModelRenderer clothRenderer, bodyRenderer;
+    clothRenderer.Setup(drawnModel);
+    bodyRenderer.Setup(bodyModel);
+
+    // On its own thread the simulation owns both models and publishes every finished frame; the render loop
+    // uploads the newest one into the renderer and sends the settings the other way, so the frame rate
+    // stays at the display's while the simulation runs as fast as it can, and neither waits for the other.
+    TripleBuffer<SimulationSettings> settingsBuffer;
+    TripleBuffer<SimulationFrame> frames;
+    SimulationThread simulation;
+    SimulationSettings simulationSettings = settings;
+    int displayTopology = ourModel.topologyVersion;
+    if (simulationThread)
+    {
+        simulation.Start([&]()
+            {
+                if (settingsBuffer.Update())
+                    simulationSettings = settingsBuffer.Front();
+                double start = glfwGetTime();
+                simulateFrame(ourModel, renderModel, simulationSettings, ballCollider, bodyCollider, frameCount, writesDone);
+                SimulationFrame& frame = frames.Back();
+                captureFrame(ourModel, renderModel, frame);
+                frame.stats.stepMs = (float)((glfwGetTime() - start) * 1000.0);
+                frames.Publish();
+                stepCrowd();
+            });
+    }
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
     {
-        double prev = glfwGetTime();
-        double now;
         // per-frame time logic
         // --------------------
         float currentFrame = static_cast<float>(glfwGetTime());
@@ -165,99 +463,65 @@ int main()
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        if (useWind) 
+        if (simulationThread)
         {
-            ourModel.SimulateWind(glm::vec3(0, 10, 0));
-            now = glfwGetTime();
-            windSimTime = now - prev;
-            prev = now;
+            settingsBuffer.Back() = settings;
+            settingsBuffer.Publish();
+            if (frames.Update())
+            {
+                const SimulationFrame& frame = frames.Front();
+                for (int i = 0; i < clothRenderer.meshes.size() && i < frame.vertices.size(); i++)
+                {
+                    if (frame.topology != displayTopology)
+                        clothRenderer.meshes[i].UpdateIndices(frame.vertices[i], frame.indices[i]);
+                    clothRenderer.meshes[i].UpdateVertices(frame.vertices[i]);
+                }
+                displayTopology = frame.topology;
+                stats = frame.stats;
+            }
         }
-
-        ourModel.SimulateInternalForce(0.0016);
-        now = glfwGetTime();
-        springTime = now - prev;
-        prev = now;
-
-        ourModel.SimulateGravity();
-        now = glfwGetTime();
-        gravitySimTime = now - prev;
-        prev = now;
-
-        ourModel.CollisionTest(glm::vec3(-5.0f, -10.5f, 5.0f), glm::vec3(0, 1, 0));
-        now = glfwGetTime();
-        holderSimTime = now - prev;
-        prev = now;
-
-        if (useFriction)
+        else
         {
-            ourModel.SimulateFriction(glm::vec3(0.0f, -9.5f, 0.0f), radian);
-            now = glfwGetTime();
-            frictionTime = now - prev;
-            prev = now;
+            double start = glfwGetTime();
+            simulateFrame(ourModel, renderModel, settings, ballCollider, bodyCollider, frameCount, writesDone);
+            captureStats(ourModel, stats);
+            stats.stepMs = (float)((glfwGetTime() - start) * 1000.0);
+            clothRenderer.Update(drawnModel);
+            stepCrowd();
         }
+        if (crowdFrames.Update())
+            crowd.Upload(crowdFrames.Front());
 
-
-        if (useBallTest) 
-        {
-            ourModel.CollisionBallTest(glm::vec3(0.0f, -9.5f, 0.0f), radian);
-            now = glfwGetTime();
-            ballTime = now - prev;
-            prev = now;
-        }
-
-        if (useCorner) 
-        {
-            ourModel.SimulateCorners(100, 120);
-            now = glfwGetTime();
-            cornerTime = now - prev;
-            prev = now;
-        }
-
-        ourModel.SimulateNodes(0.0016);
-        now = glfwGetTime();
-        nodesSimTime = now - prev;
-        prev = now;
-
-
-        ourModel.updatePosition();
+        frame.projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        frame.view = camera.GetViewMatrix();
+        frame.viewPos = glm::vec4(camera.Position, 1.0f);
+        frameUniforms.Update(frame);
 
         clothShader.use();
 
-        clothShader.setVec3("viewPos", camera.Position);
-        clothShader.setFloat("material.shininess", 32.0f);
-        clothShader.setVec3("light.direction", -0.2f, -1.0f, -0.3f);
-        clothShader.setVec3("light.ambient", 0.25f, 0.25f, 0.25f);
-        clothShader.setVec3("light.diffuse", 0.6f, 0.6f, 0.6f);
-        clothShader.setVec3("light.specular", 0.8f, 0.8f, 0.8f);
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        clothShader.setMat4("projection", projection);
-        clothShader.setMat4("view", view);
-
         // render the loaded model
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
         //model = glm::rotate(model, (float)glfwGetTime(), glm::vec3(0.0f, 2.0f, 0.0f));
         model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));	// it's a bit too big for our scene, so scale it down
-        clothShader.setMat4("model", model);
+        clothShader.setMat4(clothModelUniform, model);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, diffuseMap);
-        ourModel.Draw(clothShader);
+        clothRenderer.Draw(clothShader);
+        if (bodyCollider >= 0 && settings.useBody)
+            bodyRenderer.Draw(clothShader);
+        if (crowd.InstanceCount() > 0)
+        {
+            clothShader.setMat4(clothModelUniform, glm::mat4(1.0f));
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, diffuseMap);
+            crowd.Draw();
+        }
 
         planeShader.use();
-        planeShader.setVec3("viewPos", camera.Position);
-        planeShader.setFloat("material.shininess", 32.0f);
-        planeShader.setVec3("light.direction", -0.2f, -1.0f, -0.3f);
-        planeShader.setVec3("light.ambient", 0.25f, 0.25f, 0.25f);
-        planeShader.setVec3("light.diffuse", 0.6f, 0.6f, 0.6f);
-        planeShader.setVec3("light.specular", 0.8f, 0.8f, 0.8f);
-        projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        view = camera.GetViewMatrix();
-        planeShader.setMat4("projection", projection);
-        planeShader.setMat4("view", view);
         glm::mat4 clothmodel = glm::mat4(1.0f);
         clothmodel = glm::translate(clothmodel, glm::vec3(0.0f, -10.0f, 0.0f));
-        planeShader.setMat4("model", clothmodel);
+        planeShader.setMat4(planeModelUniform, clothmodel);
         glBindVertexArray(planeVAO);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, diffuseMap);
@@ -275,13 +539,57 @@ int main()
 
             ImGui::Begin("Test"); // Create a window called "Hello, world!" and append into it.
             ImGui::Text("Wind");
-            ImGui::Checkbox("Use Wind", &useWind);
-            ImGui::Checkbox("Use Corner", &useCorner);
-            ImGui::Checkbox("Use Ball Test", &useBallTest);
-            ImGui::Checkbox("Use Friction Test", &useFriction);
+            ImGui::Checkbox("Use Wind", &settings.useWind);
+            ImGui::Checkbox("Use Corner", &settings.useCorner);
+            ImGui::Checkbox("Use Ball Test", &settings.useBallTest);
+            ImGui::Checkbox("Move Ball", &settings.useMovingBall);
+            ImGui::SliderInt("Substeps", &settings.substeps, 1, 8);
+            ImGui::Checkbox("Use Friction Test", &settings.useFriction);
+            ImGui::Text("Contacts %d, warm started %d", stats.contacts, stats.matched);
+            ImGui::Text("Broad phase pairs %d, cloth-cloth %d", stats.broadPhasePairs, stats.clothPairs);
+            ImGui::Checkbox("Use Self Collision", &settings.useSelfCollision);
+            if (settings.useSelfCollision)
+            {
+                const BVHStats& bvh = stats.bvh;
+                ImGui::Text("BVH refit %.3f ms, traverse %.3f ms, rebuilds %d", bvh.refitMs, bvh.traverseMs, bvh.rebuilds);
+                ImGui::Text("BVH quality %.2f, overlap %.2f, pairs %d", bvh.quality, bvh.overlap, bvh.pairs);
+                ImGui::Checkbox("Normal Cone Culling (approximate)", &settings.normalConeCulling);
+                ImGui::Text("Normal cones culled %d self tests", bvh.culled);
+            }
+            ImGui::Checkbox("Use CCD", &settings.useCCD);
+            if (settings.useCCD)
+            {
+                ImGui::Text("CCD impacts %d after %d iterations", stats.ccdImpacts, stats.ccdIterations);
+                ImGui::Text("Impact zones %d, largest %d, %d iterations", stats.zoneCount, stats.largestZone, stats.zoneIterations);
+            }
+            ImGui::Checkbox("Projective Dynamics (multigrid)", &settings.useProjective);
+            if (settings.useProjective)
+            {
+                ImGui::SliderInt("PD iterations", &settings.projectiveIterations, 1, 16);
+                ImGui::SliderInt("V-cycles", &settings.projectiveCycles, 1, 4);
+                ImGui::Text("Multigrid levels %d, residual %.2e", stats.levels, stats.residual);
+            }
+            // set up before the simulation started, so safe to read here
+            if (ourModel.remeshing)
+            {
+                ImGui::Text("Particles %d of %d", stats.particles, ourModel.remesher.budget);
+                ImGui::Text("Remeshing: %d splits, %d collapses, %d flips, plan %.3f ms", stats.splits, stats.collapses, stats.flips, stats.planMs);
+                ImGui::SliderInt("Remesh interval", &settings.remeshInterval, 1, 60);
+            }
+            if (ourModel.tearable)
+            {
+                ImGui::SliderFloat("Tear strain", &settings.tearStrain, 0.1f, 2.0f);
+                ImGui::Text("Torn edges %d, particles %d, last tear %.3f ms", stats.totalTears, stats.particles, stats.tearMs);
+            }
+            if (bodyCollider >= 0)
+                ImGui::Checkbox("Use Body Collider", &settings.useBody);
 
             if (ImGui::Button("Write new file"))                            // Buttons return true when clicked (most widgets return true when edited/activated)
-                ourModel.Write("New10x10.txt");
+                settings.writeRequests++;
+
+            ImGui::Text("Simulation %.3f ms/frame%s", stats.stepMs, simulationThread ? " on its own thread" : "");
+            if (crowd.InstanceCount() > 0)
+                ImGui::Text("Crowd of %d in one draw call, step %.3f ms, pack %.3f ms", crowd.InstanceCount(), crowdFrames.Front().stepMs, crowdFrames.Front().packMs);
 
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
             ImGui::End();
@@ -296,10 +604,165 @@ int main()
         glfwPollEvents();
     }
 
+    simulation.Stop();
     glfwTerminate();
     return 0;
 }
 
+// one rendered frame worth of simulation: the substeps, then the per frame updates
+void simulateFrame(Model& ourModel, Model& renderModel, const SimulationSettings& settings, int ballCollider, int bodyCollider, int& frameCount, int& writesDone)
+{
+    ourModel.clothBVH.normalConeCulling = settings.normalConeCulling;
+    ourModel.projective.iterations = settings.projectiveIterations;
+    ourModel.projective.cycles = settings.projectiveCycles;
+    ourModel.remesher.interval = settings.remeshInterval;
+    ourModel.tearing.tearStrain = settings.tearStrain;
+    if (writesDone != settings.writeRequests)
+    {
+        writesDone = settings.writeRequests;
+        ourModel.Write("New10x10.txt");
+    }
+
+    double prev = glfwGetTime();
+    double now;
+    // colliders are posed once per frame, each substep moves them part of the way
+    if (settings.useMovingBall)
+        animationTime += timeStep * settings.substeps;
+    ourModel.colliders.Animate(animationTime, timeStep * settings.substeps);
+
+    for (int substep = 0; substep < settings.substeps; substep++)
+    {
+        ourModel.colliders.Interpolate((float)substep / settings.substeps, (float)(substep + 1) / settings.substeps);
+
+        if (settings.useWind) 
+        {
+            ourModel.SimulateWind(glm::vec3(0, 10, 0));
+            now = glfwGetTime();
+            windSimTime = now - prev;
+            prev = now;
+        }
+
+        if (!settings.useProjective)
+            ourModel.SimulateInternalForce(timeStep);
+        now = glfwGetTime();
+        springTime = now - prev;
+        prev = now;
+
+        ourModel.SimulateGravity();
+        now = glfwGetTime();
+        gravitySimTime = now - prev;
+        prev = now;
+
+        ourModel.colliders.colliders[ballCollider].enabled = settings.useBallTest;
+        // the friction test spins the ball, the contact friction drags the cloth along
+        ourModel.colliders.colliders[ballCollider].angularVelocity = settings.useFriction ? glm::vec3(0, radian, 0) : glm::vec3(0);
+        if (bodyCollider >= 0)
+            ourModel.colliders.colliders[bodyCollider].enabled = settings.useBody;
+        ourModel.SimulateCollision(timeStep);
+        now = glfwGetTime();
+        holderSimTime = now - prev;
+        prev = now;
+
+        if (settings.useCorner) 
+        {
+            for (int c = 0; c < ourModel.cloths.size(); c++)
+                ourModel.SimulateCorners(ourModel.cloths[c].anchors[0], ourModel.cloths[c].anchors[1]);
+            now = glfwGetTime();
+            cornerTime = now - prev;
+            prev = now;
+        }
+
+        if (settings.useProjective)
+            ourModel.SimulateProjective(timeStep);
+        else
+            ourModel.SimulateNodes(timeStep);
+        now = glfwGetTime();
+        nodesSimTime = now - prev;
+        prev = now;
+
+        if (settings.useSelfCollision)
+        {
+            ourModel.SimulateSelfCollision();
+            ourModel.FindSelfCollisionPairs();
+            now = glfwGetTime();
+            selfCollisionTime = now - prev;
+            prev = now;
+        }
+
+        if (settings.useCCD)
+        {
+            ourModel.SimulateContinuousCollision();
+            now = glfwGetTime();
+            ccdTime = now - prev;
+            prev = now;
+        }
+    }
+
+    ourModel.updatePosition();
+    if (!renderModel.meshes.empty())
+        ourModel.UpdateEmbedded(renderModel);
+    ourModel.UpdateRemeshing(frameCount++);
+    ourModel.UpdateTearing();
+}
+
+void captureStats(const Model& ourModel, SimulationStats& stats)
+{
+    stats.contacts = ourModel.contactCaches.empty() ? 0 : (int)ourModel.contactCaches[0].contacts.size();
+    stats.matched = ourModel.contactCaches.empty() ? 0 : ourModel.contactCaches[0].matched;
+    stats.broadPhasePairs = (int)ourModel.broadPhase.pairs.size();
+    stats.clothPairs = ourModel.clothPairs;
+    stats.bvh = ourModel.clothBVH.stats;
+    stats.ccdImpacts = (int)ourModel.ccd.impacts.size();
+    stats.ccdIterations = ourModel.ccd.iterations;
+    stats.zoneCount = ourModel.impactZones.zoneCount;
+    stats.largestZone = ourModel.impactZones.largestZone;
+    stats.zoneIterations = ourModel.impactZones.iterations;
+    stats.levels = ourModel.projective.multigrid.LevelCount();
+    stats.residual = ourModel.projective.residual;
+    stats.particles = ourModel.meshes.empty() ? 0 : (int)ourModel.meshes[0].vertices.size();
+    stats.splits = ourModel.remesher.splits;
+    stats.collapses = ourModel.remesher.collapses;
+    stats.flips = ourModel.remesher.flips;
+    stats.planMs = ourModel.remesher.planMs;
+    stats.totalTears = ourModel.tearing.totalTears;
+    stats.tearMs = ourModel.tearing.tearMs;
+}
+
+// copies what the renderer draws, the indices only into a slot that still holds an older topology
+void captureFrame(const Model& ourModel, const Model& renderModel, SimulationFrame& frame)
+{
+    const vector<Mesh>& drawn = renderModel.meshes.empty() ? ourModel.meshes : renderModel.meshes;
+    frame.vertices.resize(drawn.size());
+    frame.indices.resize(drawn.size());
+    for (int i = 0; i < drawn.size(); i++)
+    {
+        frame.vertices[i] = drawn[i].vertices;
+        if (frame.topology != ourModel.topologyVersion)
+            frame.indices[i] = drawn[i].indices;
+    }
+    frame.topology = ourModel.topologyVersion;
+    captureStats(ourModel, frame.stats);
+}
+
+// count variants of the generated cloth (32 x 32 unless --grid or --circle says otherwise), a sweep over the
+// spring stiffnesses and damping with every other variant in the wind
+void makeBatch(int count, int clothResolution, bool circularCloth, ClothBatch& batch, ClothGrid& clothGrid)
+{
+    int resolution = clothResolution > 0 ? clothResolution : 32;
+    if (circularCloth)
+        ClothGenerator::Circle(resolution, 1.0f, clothGrid);
+    else
+        ClothGenerator::Rectangle(resolution, resolution, 2.0f, 2.0f, clothGrid);
+    vector<int> pinned(clothGrid.anchors, clothGrid.anchors + 2);
+    batch.SetTopology(clothGrid.vertices, clothGrid.edges, clothGrid.diagonals, pinned);
+    for (int b = 0; b < count; b++)
+    {
+        float t = count > 1 ? (float)b / (count - 1) : 0.0f;
+        ClothVariant variant = { 500.0f + 1500.0f * t, 800.0f - 600.0f * t, 0.5f + 1.5f * t, b % 2 ? glm::vec3(0, 10, 0) : glm::vec3(0) };
+        batch.AddInstance(variant);
+    }
+}
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow* window)
@@ -1,22 +1,33 @@
 #ifndef MODEL_H
 #define MODEL_H
 
-#include <glad/glad.h> 
+// The simulation only: no GL, GLFW or ImGui. Textures are recorded by the path the material names, and
+// drawing the meshes and uploading them is the business of a ModelRenderer (ModelRenderer.h).
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include "std_image.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-#include "Mesh.h"
-#include "shader.h"
+#include "mesh.h"
 #include "Spring.h"
+#include "Collider.h"
+#include "ContactCache.h"
+#include "SelfCollision.h"
+#include "BVH.h"
+#include "CCD.h"
+#include "ImpactZones.h"
+#include "BroadPhase.h"
+#include "ClothGenerator.h"
+#include "Reorder.h"
+#include "Embedding.h"
+#include "Normals.h"
+#include "ProjectiveDynamics.h"
+#include "Remesher.h"
+#include "Tearing.h"
+#include "Topology.h"
 #include <cstdio>
-#include <imgui.h>
-#include <imgui_impl_opengl3.h>
-#include <imgui_impl_glfw.h>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -30,27 +41,7 @@
 
 using namespace std;
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
-
-struct Triple
-{
-    int firstVertex;
-    int secondVertex;
-    int faceIndex;
-};
-
-struct Edge
-{
-    int firstVertex;
-    int secondVertex;
-};
-
-struct Neighbour 
-{
-    int firstTriangle;
-    int secondTriangle;
-};
-bool cmp(Triple t1, Triple t2)
+inline bool cmp(Triple t1, Triple t2)
 {
     if (t1.firstVertex != t2.firstVertex)
     {
@@ -66,11 +57,9 @@ class Model
 {
 public:
     // model data 
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
-    vector<Mesh>    meshes;
+    vector<Mesh>    meshes;             // after read or LoadCloth: one mesh, the particle pool of every cloth
+    vector<ClothRange> cloths;          // what of the pool belongs to each cloth
     vector<aiFace> temp_faces;
-    vector<int> index_Normal;
-    vector<int> index_Tex;
     vector<glm::vec3> sortedPosition;
     vector<glm::vec3> position;
     vector<Triple> triple;
@@ -89,65 +78,145 @@ public:
     float dampCoef = 1.0;
 
     bool isFalling = true;
-    bool isRotating = false;
     bool stopCollsion = false;
     vector<Spring> springs;
-    float ballVelocity = 5;
-    float ballacc = 0.2;
-    float staticU = 0.6f;
-    float dynamicU = 0.3f;
+    ColliderSet colliders;
+    vector<ContactCache> contactCaches;   // one per mesh
+    SelfCollision selfCollision;
+    TriangleBVH clothBVH;
+    ContinuousCollision ccd;
+    ImpactZones impactZones;
+    vector<TrianglePair> selfPairs;
+    SweepAndPrune broadPhase;
+    vector<int> clothProxies;           // broad phase proxy of every cloth
+    vector<int> colliderProxies;        // of every collider, -1 while it is disabled
+    vector<vector<int>> clothColliders; // colliders the broad phase pairs with each cloth
+    int clothPairs = 0;                 // overlapping cloth pairs, for cloth-cloth collision
+    vector<int> particleOrder;          // original index of every particle, empty until reordered or edited
+    vector<int> particleSlot;           // current index of every original particle, -1 for a removed one
+    vector<EmbeddedMesh> embeddings;    // one per mesh of the render model driven by Embed
+    ProjectiveDynamics projective;      // implicit alternative to SimulateInternalForce + SimulateNodes
+    AdaptiveRemesher remesher;
+    bool remeshing = false;
+    ClothTearing tearing;
+    bool tearable = false;
+    int topologyVersion = 0;            // counts the reorders, remeshes and tears that changed the index buffer
+    vector<VertexNormals> vertexNormals;    // one per mesh, recomputed by updatePosition
     // constructor, expects a filepath to a 3D model.
     Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader& shader)
+    // an empty model, filled by Load or LoadCloth
+    Model() : gammaCorrection(false)
     {
-        for (unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+    }
 
+    void Load(string const& path)
+    {
+        loadModel(path);
     }
-    void read() 
+
+    // takes a generated cloth in place of a loaded one; its connectivity comes with it, so read and
+    // vertexSort are not needed before CreateSpring
+    void LoadCloth(ClothGrid& grid)
     {
-        vector<Vertex> sortedVertex;
+        meshes.clear();
+        cloths.clear();
+        edge.clear();
+        diagonal.clear();
+        nei.clear();
+        springs.clear();
+        AddCloth(grid);
+    }
+
+    // Appends a generated cloth, moved by offset, to the particle pool together with its connectivity; returns
+    // its index in cloths. Every pass runs over the whole pool, so each further cloth only adds its own
+    // particles, triangles and springs (made here if CreateSpring already ran). The springs of the others are
+    // re-pointed if the pool has to grow.
+    int AddCloth(ClothGrid& grid, glm::vec3 offset = glm::vec3(0))
+    {
+        for (int i = 0; i < grid.vertices.size(); i++)
+            grid.vertices[i].Position += offset;
+        bool withSprings = !springs.empty();
+        int c = appendCloth(grid.vertices, grid.indices, vector<Texture>());
+        ClothRange& cloth = cloths[c];
+        int first = cloth.firstParticle;
+        for (int i = 0; i < grid.edges.size(); i++)
+        {
+            Edge e = { grid.edges[i].firstVertex + first, grid.edges[i].secondVertex + first };
+            edge.push_back(e);
+        }
+        for (int i = 0; i < grid.diagonals.size(); i++)
+        {
+            Edge e = { grid.diagonals[i].firstVertex + first, grid.diagonals[i].secondVertex + first };
+            Neighbour n = { grid.neighbours[i].firstTriangle + cloth.firstTriangle, grid.neighbours[i].secondTriangle + cloth.firstTriangle };
+            diagonal.push_back(e);
+            nei.push_back(n);
+        }
+        cloth.edgeCount = grid.edges.size();
+        cloth.diagonalCount = grid.diagonals.size();
+        cloth.anchors[0] = grid.anchors[0] + first;
+        cloth.anchors[1] = grid.anchors[1] + first;
+        if (withSprings) createSprings(c);
+        return c;
+    }
+
+    // gathers the triangles of every mesh into one welded position/index list, e.g. for baking a collider
+    void CollectTriangles(vector<glm::vec3>& positions, vector<unsigned int>& indices) const
+    {
+        map<array<float, 3>, unsigned int> welded;
         for (int i = 0; i < meshes.size(); i++)
         {
-            for (int j = 0; j < meshes[i].vertices.size(); j++)
+            for (int j = 0; j < meshes[i].indices.size(); j++)
             {
-                bool add = true;
-                for (int k = 0; k < j; k++)
+                const glm::vec3& p = meshes[i].vertices[meshes[i].indices[j]].Position;
+                array<float, 3> key = { p.x, p.y, p.z };
+                auto found = welded.find(key);
+                if (found == welded.end())
                 {
-                    if (meshes[i].vertices[j].Position == meshes[i].vertices[k].Position)
-                        add = false;
-                }
-                if (add == true)
-                {
-                    sortedVertex.push_back(meshes[i].vertices[j]);
+                    found = welded.insert(make_pair(key, (unsigned int)positions.size())).first;
+                    positions.push_back(p);
                 }
+                indices.push_back(found->second);
             }
         }
+    }
 
-        for (int i = 0; i < meshes.size(); i++) 
-        {
-            for (int j = 0; j < meshes[i].indices.size(); j++) 
+    // welds the vertices each mesh repeats per face (same position) and gathers the meshes into the particle
+    // pool, one cloth per mesh that keeps the textures of its material; vertexSort then builds the connectivity
+    // of every cloth
+    void read() 
+    {
+        vector<Mesh> loaded;
+        loaded.swap(meshes);
+        cloths.clear();
+        for (int i = 0; i < loaded.size(); i++)
+        {
+            map<array<float, 3>, unsigned int> welded;
+            vector<Vertex> sortedVertex;
+            vector<unsigned int> weld(loaded[i].vertices.size());
+            for (int j = 0; j < loaded[i].vertices.size(); j++)
             {
-                glm::vec3 temp_position = meshes[i].vertices[meshes[i].indices[j]].Position;
-                for (int k = 0; k < sortedVertex.size(); k++) 
+                const glm::vec3& p = loaded[i].vertices[j].Position;
+                array<float, 3> key = { p.x, p.y, p.z };
+                auto found = welded.find(key);
+                if (found == welded.end())
                 {
-                    if (temp_position == sortedVertex[k].Position) 
-                    {
-                        meshes[i].indices[j] = k;
-                    }
+                    found = welded.insert(make_pair(key, (unsigned int)sortedVertex.size())).first;
+                    sortedVertex.push_back(loaded[i].vertices[j]);
                 }
+                weld[j] = found->second;
             }
-        }
-        for (int i = 0; i < meshes.size(); i++)
-        {
-            meshes[i] = Mesh(sortedVertex, meshes[i].indices, meshes[i].textures);
+            vector<unsigned int> indices(loaded[i].indices.size());
+            for (int j = 0; j < indices.size(); j++)
+                indices[j] = weld[loaded[i].indices[j]];
+            appendCloth(sortedVertex, indices, loaded[i].materials[0].textures);
         }
     }
+    // exports every particle with its own texture coordinate and normal, in the original order of the
+    // particles (those added since come after), and every triangle as a face whose corners name all three
     void Write(string file_name)
     {
         ofstream dataFile;
@@ -157,15 +226,24 @@ public:
         vector<glm::vec3> temp_Position;
         vector<glm::vec3> temp_Normal;
         vector<glm::vec2> temp_tex;
-        vector<unsigned int> temp_indices;
+        vector<vector<int>> exported(meshes.size());   // line of every vertex of each mesh
         for (i = 0; i < meshes.size(); i++) 
         {
-            for (j = 0; j < meshes[i].vertices.size(); j++) 
+            int count = meshes[i].vertices.size();
+            vector<int> order(count);
+            for (j = 0; j < count; j++)
+                order[j] = j;
+            // the pool is the one reordered, remeshed or torn
+            if (i == 0)
+                stable_sort(order.begin(), order.end(), [&](int a, int b) { return OriginalParticle(a) < OriginalParticle(b); });
+            exported[i].resize(count);
+            for (j = 0; j < count; j++) 
             {
-                temp_Position.push_back(meshes[i].vertices[j].Position);
-                temp_Normal.push_back(meshes[i].vertices[j].Normal);
-                temp_tex.push_back(meshes[i].vertices[j].TexCoords);
-                temp_indices.push_back(meshes[i].indices[j]);
+                const Vertex& vertex = meshes[i].vertices[order[j]];
+                exported[i][order[j]] = temp_Position.size();
+                temp_Position.push_back(vertex.Position);
+                temp_Normal.push_back(vertex.Normal);
+                temp_tex.push_back(vertex.TexCoords);
             }
         }
 
@@ -189,204 +267,346 @@ public:
         {
             for (j = 0; j < meshes[i].indices.size()/3; j++)
             {
-                int k,temp1,temp2;
-                for (k = 0; k < temp_Normal.size(); k++)
+                dataFile << "f";
+                for (int k = 0; k < 3; k++)
                 {
-                    if (temp_Normal[k] == temp_Normal[index_Normal[k]]) temp1 = index_Normal[k];
+                    int v = exported[i][meshes[i].indices[3 * j + k]];
+                    dataFile << " " << v << "/" << v << "/" << v;
                 }
-                for (k = 0; k < temp_tex.size(); k++)
-                {
-                    if (temp_tex[k] == temp_tex[index_Normal[k]]) temp2 = index_Tex[k];
-                }
-                dataFile << "f" << " " << meshes[i].indices[j] << "/" << temp2 << "/" << temp1 <<" ";
+                dataFile << endl;
             }
-            dataFile << " " << endl;
         }
         dataFile.close();
     }
+    // the triangle edges (structural springs), the pairs of triangles sharing an edge and their opposite
+    // vertices (bending springs) of every cloth, each cloth from its own triangles
     void vertexSort() 
     {
-        for (int k = 0; k < meshes.size(); k++) 
-        {
-            for (int i = 0; i < meshes[k].indices.size()/3; i++)
-            {
-                Triple tempTriple;
-                tempTriple.firstVertex = meshes[k].indices[3 * i];
-                tempTriple.secondVertex = meshes[k].indices[3 * i + 1];
-                tempTriple.faceIndex = i;
-                triple.push_back(tempTriple);
-                tempTriple.firstVertex = meshes[k].indices[3 * i + 1];
-                tempTriple.secondVertex = meshes[k].indices[3 * i + 2];
-                tempTriple.faceIndex = i;
-                triple.push_back(tempTriple);
-                tempTriple.firstVertex = meshes[k].indices[3 * i + 2];
-                tempTriple.secondVertex = meshes[k].indices[3 * i];
-                tempTriple.faceIndex = i;
-                triple.push_back(tempTriple);
-            }
-        }
+        edge.clear();
+        diagonal.clear();
+        nei.clear();
+        for (int c = 0; c < cloths.size(); c++)
+            sortCloth(cloths[c]);
+    }
 
-        //sort
-        for (int i = 0; i < triple.size(); i++) 
-        {
-            if (triple[i].firstVertex > triple[i].secondVertex) 
-            {
-                int temp = triple[i].secondVertex;
-                triple[i].secondVertex = triple[i].firstVertex;
-                triple[i].firstVertex = temp;
-            }
-        }
-        sort(triple.begin(), triple.end(), cmp);
+    // current index of an original particle, -1 once remeshing removed it, and back
+    int Particle(int original) const
+    {
+        return original < particleSlot.size() ? particleSlot[original] : original;
+    }
 
-        //removal
-        for (int i = 0; i < triple.size()-1; i++) 
-        {
-            for (int j = i+1; j < triple.size(); j++) 
+    int OriginalParticle(int particle) const
+    {
+        return particle < particleOrder.size() ? particleOrder[particle] : particle;
+    }
+
+    // Optional, after the topology is built and before CreateSpring. Renumbers the particles along a reverse
+    // Cuthill-McKee (or Morton curve) order and sorts the structural and bending lists by their first
+    // particle, so the springs created from them walk the particles almost sequentially. The triangle order
+    // is kept, so nei stays valid; Particle/OriginalParticle translate the indices used outside, e.g. the
+    // corners to pin or the export. Every cloth is reordered within its own range of the pool.
+    void ReorderParticles(bool morton = false)
+    {
+        if (meshes.empty()) return;
+        int count = meshes[0].vertices.size();
+        vector<int> order(count);
+        for (int c = 0; c < cloths.size(); c++)
+        {
+            const ClothRange& cloth = cloths[c];
+            int first = cloth.firstParticle;
+            vector<int> local;
+            if (morton)
+                local = MortonOrder(vector<Vertex>(meshes[0].vertices.begin() + first, meshes[0].vertices.begin() + first + cloth.particleCount));
+            else
             {
-                if ((triple[j].firstVertex == triple[i].firstVertex) && (triple[j].secondVertex == triple[i].secondVertex)
-                    || (triple[j].firstVertex == triple[i].secondVertex) && (triple[j].secondVertex == triple[i].firstVertex))
+                vector<Edge> edges(edge.begin() + cloth.firstEdge, edge.begin() + cloth.firstEdge + cloth.edgeCount);
+                for (int j = 0; j < edges.size(); j++)
                 {
-                    Neighbour n;
-                    n.firstTriangle = triple[i].faceIndex;
-                    n.secondTriangle = triple[j].faceIndex;
-                    nei.push_back(n);
-
-                    Triple temp = triple[triple.size()-1];
-                    triple[triple.size() - 1] = triple[j];
-                    triple[j] = temp;
-                    triple.pop_back();
-
+                    edges[j].firstVertex -= first;
+                    edges[j].secondVertex -= first;
                 }
+                local = ReverseCuthillMcKee(cloth.particleCount, edges);
             }
+            for (int k = 0; k < cloth.particleCount; k++)
+                order[first + k] = first + local[k];
         }
-        for (int i = 0; i < triple.size() - 1; i++)
+        vector<int> slot(count);
+        for (int k = 0; k < count; k++)
+            slot[order[k]] = k;
+
+        for (int i = 0; i < meshes.size(); i++)
         {
-            for (int j = i + 1; j < triple.size(); j++)
-            {
-                if ((triple[j].firstVertex == triple[i].firstVertex) && (triple[j].secondVertex == triple[i].secondVertex)
-                    || (triple[j].firstVertex == triple[i].secondVertex) && (triple[j].secondVertex == triple[i].firstVertex))
-                {
-                    Neighbour n;
-                    n.firstTriangle = triple[i].faceIndex;
-                    n.secondTriangle = triple[j].faceIndex;
-                    nei.push_back(n);
+            vector<Vertex> reordered(count);
+            for (int k = 0; k < count; k++)
+                reordered[k] = meshes[i].vertices[order[k]];
+            meshes[i].vertices.swap(reordered);
+            for (int j = 0; j < meshes[i].indices.size(); j++)
+                meshes[i].indices[j] = slot[meshes[i].indices[j]];
+        }
+        topologyVersion++;
+
+        auto renumber = [&](Edge& e)
+        {
+            int a = slot[e.firstVertex], b = slot[e.secondVertex];
+            e.firstVertex = min(a, b);
+            e.secondVertex = max(a, b);
+        };
+        auto before = [](const Edge& a, const Edge& b)
+        {
+            return a.firstVertex < b.firstVertex || (a.firstVertex == b.firstVertex && a.secondVertex < b.secondVertex);
+        };
+        for (int j = 0; j < edge.size(); j++)
+            renumber(edge[j]);
+        for (int j = 0; j < diagonal.size(); j++)
+            renumber(diagonal[j]);
+        for (int c = 0; c < cloths.size(); c++)
+        {
+            const ClothRange& cloth = cloths[c];
+            sort(edge.begin() + cloth.firstEdge, edge.begin() + cloth.firstEdge + cloth.edgeCount, before);
+            sort(diagonal.begin() + cloth.firstDiagonal, diagonal.begin() + cloth.firstDiagonal + cloth.diagonalCount, before);
+        }
+
+        // compose with an earlier reordering
+        if (!particleOrder.empty())
+            for (int k = 0; k < count; k++)
+                order[k] = particleOrder[order[k]];
+        particleOrder = order;
+        particleSlot.assign(*max_element(order.begin(), order.end()) + 1, -1);
+        for (int k = 0; k < count; k++)
+            particleSlot[particleOrder[k]] = k;
+    }
 
-                    Triple temp = triple[triple.size() - 1];
-                    triple[triple.size() - 1] = triple[j];
-                    triple[j] = temp;
-                    triple.pop_back();
+    // springs of every cloth, each cloth's structural then bending springs in one range
+    void CreateSpring() 
+    {
+        springs.clear();
+        for (int c = 0; c < cloths.size(); c++)
+            createSprings(c);
+    }
 
-                }
-            }
-        }
+    // average rest length of the structural edges
+    float AverageEdgeLength()
+    {
+        if (meshes.empty() || edge.empty()) return 0;
+        float sum = 0;
+        for (int j = 0; j < edge.size(); j++)
+            sum += glm::length(meshes[0].vertices[edge[j].firstVertex].Position - meshes[0].vertices[edge[j].secondVertex].Position);
+        return sum / edge.size();
+    }
 
-        //edge list
-        for (int i = 0; i < triple.size(); i++) 
-        {
-            Edge e;
-            e.firstVertex = triple[i].firstVertex;
-            e.secondVertex = triple[i].secondVertex;
-            edge.push_back(e);
-        }
+    // call once after CreateSpring; the same springs and coefficients, solved implicitly
+    void SetupProjective()
+    {
+        if (meshes.empty()) return;
+        projective.SetTopology(meshes[0].vertices, edge, diagonal, structuralCoef, bendingCoef, restPositions());
+    }
 
-        //diagonal list
-        for (int i = 0; i<nei.size(); i++)
-        {
-            for (int j = 0; j < meshes.size(); j++) 
-            {
-                int index_01 = 3 * nei[i].firstTriangle;
-                int index_02 = 3 * nei[i].secondTriangle;
-                Edge temp_edge;
-                for (int k = 0; k < 3; k++) 
-                {
-                    if (meshes[j].indices[index_01 + k] != meshes[j].indices[index_02])
-                    {
-                        if (meshes[j].indices[index_01 + k] != meshes[j].indices[index_02 + 1])
-                        {
-                            if (meshes[j].indices[index_01 + k] != meshes[j].indices[index_02 + 2])
-                            {
-                                temp_edge.firstVertex = meshes[j].indices[index_01 + k];
-                            }
-                        }
-                    }
-
-                    if (meshes[j].indices[index_02 + k] != meshes[j].indices[index_01])
-                    {
-                        if (meshes[j].indices[index_02 + k] != meshes[j].indices[index_01 + 1])
-                        {
-                            if (meshes[j].indices[index_02 + k] != meshes[j].indices[index_01 + 2])
-                            {
-                                temp_edge.secondVertex = meshes[j].indices[index_02 + k];
-                            }
-                        }
-                    }
-                }
+    // Adaptive remeshing of a single cloth with at most budget particles, call once after CreateSpring and
+    // SetupSelfCollision. The remesher takes over the springs and edits them in place.
+    void SetupRemeshing(int budget)
+    {
+        if (cloths.size() != 1) return;
+        vector<Vertex>& vertices = meshes[0].vertices;
+        // springs point into the vertex array, so it must never reallocate
+        vertices.reserve(max(budget, (int)vertices.size()));
+        remesher.budget = budget;
+        remesher.minEdgeLength = 0.25f * AverageEdgeLength();
+        remesher.Setup(vertices, meshes[0].indices, springs, structuralCoef, bendingCoef, dampCoef);
+        remesher.Topology(meshes[0].indices, edge, diagonal, nei);
+        remeshing = true;
+        spanPool();
+        SetupSelfCollision();
+        SetupProjective();
+    }
 
+    // once per frame, between two steps: applies a finished pass and starts the next one every few frames.
+    // Like a tear, a pass only patches the BVH, which keeps its tree until its own rebuild trigger, and the
+    // projective hierarchy.
+    void UpdateRemeshing(int frame)
+    {
+        if (!remeshing) return;
+        Mesh& mesh = meshes[0];
+        if (remesher.Apply(mesh.vertices, mesh.indices, springs))
+        {
+            remesher.Topology(mesh.indices, edge, diagonal, nei);
+            spanPool();
+            selfCollision.SetTopology(mesh.vertices.size(), edge, diagonal, AverageEdgeLength());
+            clothBVH.thickness = selfCollision.thickness;
+            clothBVH.SetNeighbours(mesh.indices.size() / 3, nei);
+            clothBVH.UpdateTopology(mesh.indices, remesher.TriangleOrigins());
+            projective.UpdateTopology(mesh.vertices, edge, diagonal, structuralCoef, bendingCoef, restPositions(), remesher.VertexOrigins());
+            followParticles(remesher.VertexSources());
+            topologyVersion++;
+        }
+        if (!remesher.Busy() && frame % remesher.interval == 0)
+            remesher.Plan(mesh.vertices, mesh.indices);
+    }
 
-                diagonal.push_back(temp_edge);
-            }
-            
-        }
-        
-        //cout << "diagonal list" << endl;
-        for (int i = 0; i < diagonal.size(); i++) 
+    // Tearing of a single cloth with room for budget particles, call once after CreateSpring and
+    // SetupSelfCollision. Like remeshing it takes over the springs; the two do not combine.
+    void SetupTearing(int budget)
+    {
+        if (cloths.size() != 1 || remeshing) return;
+        vector<Vertex>& vertices = meshes[0].vertices;
+        // springs point into the vertex array, so it must never reallocate
+        vertices.reserve(max(budget, (int)vertices.size()));
+        tearing.Setup(vertices, meshes[0].indices, springs, structuralCoef, bendingCoef, dampCoef, edge, diagonal, nei);
+        tearable = true;
+        spanPool();
+        SetupSelfCollision();
+        SetupProjective();
+    }
+
+    // once per frame, between two steps. The lists were patched by the tear itself; what is left are the
+    // linear CSR rebuilds of the collision adjacency and the renumbered triangles of the BVH, which keeps its
+    // tree. The projective solver keeps its hierarchy too and patches it on its next step.
+    void UpdateTearing()
+    {
+        if (!tearable) return;
+        Mesh& mesh = meshes[0];
+        if (!tearing.Tear(mesh.vertices, mesh.indices, springs, edge, diagonal, nei)) return;
+        spanPool();
+        selfCollision.SetTopology(mesh.vertices.size(), edge, diagonal, AverageEdgeLength());
+        clothBVH.SetNeighbours(mesh.indices.size() / 3, nei);
+        clothBVH.UpdateTriangles(mesh.indices, tearing.changedTriangles);
+        projective.UpdateTopology(mesh.vertices, edge, diagonal, structuralCoef, bendingCoef, restPositions(), tearing.VertexOrigins());
+        followParticles(tearing.VertexSources());
+        topologyVersion++;
+    }
+
+    // takes the place of SimulateInternalForce and SimulateNodes: integrates the accumulated external
+    // forces and the springs in one implicit step
+    void SimulateProjective(float etha)
+    {
+        if (meshes.empty()) return;
+        projective.Step(meshes[0].vertices, etha);
+    }
+
+    // call once after vertexSort, the spatial hash cell size is taken from the edge lengths
+    void SetupSelfCollision()
+    {
+        if (meshes.empty()) return;
+        selfCollision.SetTopology(meshes[0].vertices.size(), edge, diagonal, AverageEdgeLength());
+        clothBVH.thickness = selfCollision.thickness;
+        clothBVH.SetNeighbours(meshes[0].indices.size() / 3, nei);
+        clothBVH.Build(meshes[0].vertices, meshes[0].indices);
+    }
+
+    // refits the face BVH to the current positions and collects the candidate triangle pairs
+    void FindSelfCollisionPairs()
+    {
+        if (meshes.empty()) return;
+        clothBVH.Refit(meshes[0].vertices);
+        clothBVH.SelfCollide(selfPairs);
+    }
+
+    void SimulateSelfCollision()
+    {
+        for (int i = 0; i < meshes.size(); i++)
         {
-            //cout << diagonal[i].firstVertex << " " << diagonal[i].secondVertex << " " << endl;
+            selfCollision.Resolve(meshes[i].vertices);
         }
+    }
 
-        //neighbour list
-        //cout << "Neighbour list" << endl;
-        for (int i = 0; i < nei.size(); i++) 
+    // refreshes the boxes of the cloths in the pool (covering the whole step) and of the colliders, and
+    // sorts out which colliders each cloth has to be tested against
+    void UpdateBroadPhase()
+    {
+        float pad = colliders.thickness + colliders.contactMargin;
+        while (clothProxies.size() > cloths.size())
         {
-           // cout << nei[i].firstTriangle << " " << nei[i].secondTriangle << " " << endl;
+            broadPhase.Remove(clothProxies.back());
+            clothProxies.pop_back();
         }
-
-        //output
-        //cout << "Edge list" << endl;
-        for (int i = 0; i < edge.size(); i++) 
+        clothProxies.resize(cloths.size(), -1);
+        for (int c = 0; c < cloths.size(); c++)
         {
-            //cout << edge[i].firstVertex << " " << edge[i].secondVertex << " "<< endl;
+            const ClothRange& cloth = cloths[c];
+            AABB box = { glm::vec3(INFINITY), glm::vec3(-INFINITY) };
+            for (int j = cloth.firstParticle; j < cloth.firstParticle + cloth.particleCount; j++)
+            {
+                const Vertex& v = meshes[0].vertices[j];
+                box.min = glm::min(box.min, glm::min(v.Position, v.oldPos));
+                box.max = glm::max(box.max, glm::max(v.Position, v.oldPos));
+            }
+            box.min -= glm::vec3(pad);
+            box.max += glm::vec3(pad);
+            if (clothProxies[c] < 0) clothProxies[c] = broadPhase.Add(box, c, BROAD_PHASE_CLOTH, BROAD_PHASE_CLOTH | BROAD_PHASE_COLLIDER);
+            else broadPhase.Update(clothProxies[c], box);
         }
-    }
 
-    void CreateSpring() 
-    {
-        for (int i = 0; i < meshes.size(); i++)
+        colliderProxies.resize(colliders.colliders.size(), -1);
+        for (int i = 0; i < colliders.colliders.size(); i++)
         {
-            //Structural
-            for (int j = 0; j < edge.size(); j++) 
+            const Collider& c = colliders.colliders[i];
+            if (!c.enabled)
             {
-                springs.push_back(Spring(&(meshes[i].vertices[edge[j].firstVertex]), &(meshes[i].vertices[edge[j].secondVertex]), structuralCoef, dampCoef));
-                //SimulateSpring(meshes[i].vertices[edge[j].firstVertex], meshes[i].vertices[edge[j].secondVertex],0.016f, structuralCoef);
+                if (colliderProxies[i] >= 0) broadPhase.Remove(colliderProxies[i]);
+                colliderProxies[i] = -1;
+                continue;
             }
+            AABB box = { c.sweepMin, c.sweepMax };
+            if (c.type == COLLIDER_PLANE)
+            {
+                box.min = glm::vec3(-INFINITY);
+                box.max = glm::vec3(INFINITY);
+            }
+            if (colliderProxies[i] < 0) colliderProxies[i] = broadPhase.Add(box, i, BROAD_PHASE_COLLIDER, BROAD_PHASE_CLOTH);
+            else broadPhase.Update(colliderProxies[i], box);
+        }
 
-            //Blending
-            for (int j = 0; j < diagonal.size(); j++)
+        broadPhase.Run();
+        clothColliders.assign(cloths.size(), vector<int>());
+        clothPairs = 0;
+        for (int i = 0; i < broadPhase.pairs.size(); i++)
+        {
+            int a = broadPhase.pairs[i].first, b = broadPhase.pairs[i].second;
+            if (broadPhase.Category(a) == BROAD_PHASE_CLOTH && broadPhase.Category(b) == BROAD_PHASE_CLOTH)
             {
-                springs.push_back(Spring(&(meshes[i].vertices[diagonal[j].firstVertex]), &(meshes[i].vertices[diagonal[j].secondVertex]), bendingCoef, dampCoef));
-                //SimulateSpring(meshes[i].vertices[diagonal[j].firstVertex], meshes[i].vertices[diagonal[j].secondVertex], 0.016f, bendingCoef);
+                clothPairs++;
+                continue;
             }
+            if (broadPhase.Category(a) != BROAD_PHASE_CLOTH) swap(a, b);
+            clothColliders[broadPhase.User(a)].push_back(broadPhase.User(b));
         }
+    }
 
+    // run after every position update of the step: swept collider tests, then swept self collision with
+    // impact zones as the fallback
+    void SimulateContinuousCollision()
+    {
+        UpdateBroadPhase();
+        for (int c = 0; c < cloths.size(); c++)
+            colliders.ResolveContinuous(meshes[0].vertices, clothColliders[c], cloths[c].firstParticle, cloths[c].particleCount);
+        for (int i = 0; i < meshes.size(); i++)
+        {
+            ccd.Resolve(meshes[i].vertices, meshes[i].indices, clothBVH);
+            // only what the impulse passes could not separate pays for the rigid zones
+            if (!ccd.impacts.empty())
+                impactZones.Resolve(meshes[i].vertices, meshes[i].indices, clothBVH, ccd);
+        }
     }
 
+    // one pass over the whole pool, whatever cloth a particle belongs to
     void SimulateNodes(float etha) 
     { 
         for (int i = 0; i < meshes.size(); i++) 
         {
-            for (int j = 0; j < meshes[i].vertices.size(); j++)
-            {
-                if (meshes[i].vertices[j].isFixed) continue;
+            vector<Vertex>& vertices = meshes[i].vertices;
+            ParallelFor(0, vertices.size(), [&](int j)
+                {
+                    Vertex& v = vertices[j];
+                    if (v.isFixed) return;
 
-                meshes[i].vertices[j].acceleration = meshes[i].vertices[j].force / meshes[i].vertices[j].mass;
-                meshes[i].vertices[j].velocity += meshes[i].vertices[j].acceleration * etha;
+                    v.acceleration = v.force / v.mass;
+                    v.velocity += v.acceleration * etha;
 
-                glm::vec3 temp = meshes[i].vertices[j].Position;
-                meshes[i].vertices[j].Position += (meshes[i].vertices[j].Position - meshes[i].vertices[j].oldPos) + meshes[i].vertices[j].velocity * etha;
-                meshes[i].vertices[j].oldPos = temp;
+                    glm::vec3 temp = v.Position;
+                    v.Position += (v.Position - v.oldPos) + v.velocity * etha;
+                    v.oldPos = temp;
 
-                meshes[i].vertices[j].force = glm::vec3(0);   // reset
-            }
+                    v.force = glm::vec3(0);   // reset
+                }, 4096);
         }
     }
 
@@ -402,169 +622,244 @@ public:
     {
         for (int i = 0; i < meshes.size(); i++)
         {
-            for (int j = 0; j < meshes[i].vertices.size(); j++)
-            {
-                meshes[i].vertices[j].force += (gravity * meshes[i].vertices[j].mass) * 20.0f;
-            }
+            vector<Vertex>& vertices = meshes[i].vertices;
+            ParallelFor(0, vertices.size(), [&](int j) { vertices[j].force += (gravity * vertices[j].mass) * 20.0f; }, 4096);
         }
     }
 
     void updatePosition()
     {
+        // same per frame reset the Mesh constructor does, but in place: the vertex arrays stay where the
+        // springs point and only the vertex buffer contents are replaced. The normals follow the cloth.
+        vertexNormals.resize(meshes.size());
         for (int i = 0; i < meshes.size(); i++)
         {
-            meshes[i] = Mesh(meshes[i].vertices, meshes[i].indices, meshes[i].textures);
+            vector<Vertex>& vertices = meshes[i].vertices;
+            ParallelFor(0, vertices.size(), [&](int j)
+                {
+                    vertices[j].force = glm::vec3(0);
+                    vertices[j].mass = 1;
+                    vertices[j].isFixed = false;
+                    vertices[j].oldPos = vertices[j].Position;
+                }, 4096);
+            vertexNormals[i].Update(vertices, meshes[i].indices, topologyVersion);
         }
+    }
 
-        for (int i = 0; i < meshes.size(); i++)
-        {
-            for (int k = 0; k < springs.size(); k++) 
-            {
-                for (int j = 0; j < edge.size(); j++)
-                {
-                    springs[j].node1 = &meshes[i].vertices[edge[j].firstVertex];
-                    springs[j].node2 = &meshes[i].vertices[edge[j].secondVertex];                   
-                }
+    // lets the first mesh drive the meshes of a finer render model; call after SetupSelfCollision, at rest
+    void Embed(Model& render)
+    {
+        if (meshes.empty()) return;
+        // the binding reads the normals of the simulated mesh, which are only those of the file until the first step
+        vertexNormals.resize(meshes.size());
+        vertexNormals[0].Update(meshes[0].vertices, meshes[0].indices, topologyVersion);
+        embeddings.resize(render.meshes.size());
+        for (int i = 0; i < render.meshes.size(); i++)
+            embeddings[i].Bind(meshes[0].vertices, meshes[0].indices, clothBVH, render.meshes[i].vertices);
+    }
 
-                //Blending
-                for (int j = 0; j < diagonal.size(); j++)
-                {
-                    springs[edge.size()-1 + j].node1 = &meshes[i].vertices[diagonal[j].firstVertex];
-                    springs[edge.size() - 1 + j].node2 = &meshes[i].vertices[diagonal[j].secondVertex];
-                    //springs.push_back(Spring(&(meshes[i].vertices[diagonal[j].firstVertex]), &(meshes[i].vertices[diagonal[j].secondVertex]), bendingCoef, dampCoef));
-                }
-            }
-        }
-        
+    // moves the render model along with the simulated mesh; call after updatePosition, which refreshed its normals
+    void UpdateEmbedded(Model& render)
+    {
+        for (int i = 0; i < embeddings.size() && i < render.meshes.size(); i++)
+            embeddings[i].Update(meshes[0].vertices, meshes[0].indices, render.meshes[i].vertices);
     }
 
     void SimulateWind(glm::vec3 windDir) 
     { 
         for (int i = 0; i < meshes.size(); i++) 
         {
-            for (int j = 0; j < meshes[i].vertices.size(); j++) 
-            {
-                meshes[i].vertices[j].force += (windDir * meshes[i].vertices[j].mass * 2.5f);
-            }
+            vector<Vertex>& vertices = meshes[i].vertices;
+            ParallelFor(0, vertices.size(), [&](int j) { vertices[j].force += (windDir * vertices[j].mass * 2.5f); }, 4096);
         } 
     }
 
-    void CollisionTest(glm::vec3 planeVertex,glm::vec3 normal) 
+    // resolves the particles of every cloth against the colliders the broad phase found near that cloth,
+    // then solves the contact velocities of the pool with friction, warm started from the previous step's contacts
+    void SimulateCollision(float etha)
     {
-        for (int i = 0; i < meshes.size(); i++) 
-        {
-            for (int j = 0; j < meshes[i].vertices.size(); j++) 
-            {
-                float distance = glm::length(meshes[i].vertices[j].Position - planeVertex);
+        UpdateBroadPhase();
+        if (meshes.empty()) return;
+        contactCaches.resize(meshes.size());
+        ContactCache& cache = contactCaches[0];
+        cache.Begin();
+        for (int i = 0; i < colliders.colliders.size(); i++)
+            colliders.colliders[i].contacts = 0;
+        for (int c = 0; c < cloths.size(); c++)
+            colliders.Resolve(meshes[0].vertices, cache.contacts, clothColliders[c], cloths[c].firstParticle, cloths[c].particleCount);
+        cache.Solve(meshes[0].vertices, colliders.colliders, etha);
+    }
 
-                glm::vec3 normal = (meshes[i].vertices[j].Position - planeVertex) / distance;
-                glm::vec3 Vn = glm::dot(meshes[i].vertices[j].velocity, normal) * normal;
-                glm::vec3 Vt = meshes[i].vertices[j].velocity - normal;
-                float a = max(float(1 - 0.3 * (1 + 0.2) * glm::length(Vn) / glm::length(Vt)), 0.0f);
-                Vn = -1.0f * 0.2f * Vn;
-                Vt = a * Vt;
+    // pins two particles of the pool, given by their original index, -1 for none
+    void SimulateCorners(int firstIndex, int secondIndex) 
+    {
+        if (meshes.empty()) return;
+        int first = firstIndex >= 0 ? Particle(firstIndex) : -1;
+        int second = secondIndex >= 0 ? Particle(secondIndex) : -1;
+        if (first >= 0) meshes[0].vertices[first].isFixed = true;
+        if (second >= 0) meshes[0].vertices[second].isFixed = true;
+    }
 
-                glm::vec3 Vnew = Vn + Vt;
-                if (distance <= 1.55 && distance >= 0.025)
-                {
-                    meshes[i].vertices[j].velocity = Vnew;
-                    meshes[i].vertices[j].velocity = glm::vec3(0);
-                }
-                else if (distance < 0.025)
-                {
-                    meshes[i].vertices[j].velocity = glm::vec3(0);
-                    meshes[i].vertices[j].Position += 0.005f * normal;
-                }
-               
-            }
-        }
+private:
+    // appends particles and triangles (numbered from 0) to the pool as a new cloth without connectivity yet;
+    // its triangles start a material range of their own unless their textures are the ones already drawn last
+    int appendCloth(vector<Vertex>& vertices, vector<unsigned int>& indices, const vector<Texture>& textures)
+    {
+        ClothRange cloth = {};
+        cloth.firstParticle = meshes.empty() ? 0 : meshes[0].vertices.size();
+        cloth.particleCount = vertices.size();
+        cloth.firstTriangle = meshes.empty() ? 0 : meshes[0].indices.size() / 3;
+        cloth.triangleCount = indices.size() / 3;
+        cloth.firstEdge = edge.size();
+        cloth.firstDiagonal = diagonal.size();
+        cloth.firstSpring = springs.size();
+        cloth.anchors[0] = cloth.anchors[1] = -1;
+        if (meshes.empty())
+        {
+            meshes.push_back(Mesh(move(vertices), move(indices), textures));
+            cloths.push_back(cloth);
+            return 0;
+        }
+
+        Mesh& pool = meshes[0];
+        // springs point into the pool, remember where in case it has to grow
+        vector<pair<int, int>> ends;
+        if (pool.vertices.size() + vertices.size() > pool.vertices.capacity())
+        {
+            ends.resize(springs.size());
+            for (int i = 0; i < springs.size(); i++)
+                ends[i] = make_pair((int)(springs[i].node1 - &pool.vertices[0]), (int)(springs[i].node2 - &pool.vertices[0]));
+        }
+        for (int i = 0; i < vertices.size(); i++)
+        {
+            // the same reset the Mesh constructor does
+            Vertex v = vertices[i];
+            v.force = glm::vec3(0);
+            v.mass = 1;
+            v.isFixed = false;
+            v.oldPos = v.Position;
+            pool.vertices.push_back(v);
+        }
+        for (int i = 0; i < ends.size(); i++)
+        {
+            springs[i].node1 = &pool.vertices[ends[i].first];
+            springs[i].node2 = &pool.vertices[ends[i].second];
+        }
+        for (int i = 0; i < indices.size(); i++)
+            pool.indices.push_back(indices[i] + cloth.firstParticle);
+        if (!sameTextures(pool.materials.back().textures, textures))
+        {
+            MaterialRange material = { cloth.firstTriangle, textures };
+            pool.materials.push_back(material);
+        }
+        topologyVersion++;
+        cloths.push_back(cloth);
+        return cloths.size() - 1;
     }
 
-    void CollisionBallTest(glm::vec3 center, float radian) 
+    static bool sameTextures(const vector<Texture>& a, const vector<Texture>& b)
     {
-        for (int i = 0; i < meshes.size(); i++)
-        {
-            for (int j = 0; j < meshes[i].vertices.size(); j++)
-            {
-                float distance = glm::length(meshes[i].vertices[j].Position - center);
-                glm::vec3 normal = (meshes[i].vertices[j].Position - center) / distance;
-                glm::vec3 Vn = glm::dot(meshes[i].vertices[j].velocity, normal) * normal;
-                glm::vec3 Vt = meshes[i].vertices[j].velocity - normal;
-                float a = max(float(1 - 0.3 * (1 + 0.2) * glm::length(Vn) / glm::length(Vt)), 0.0f);
-                Vn = -1.0f * 0.2f * Vn;
-                Vt = a * Vt;
+        if (a.size() != b.size()) return false;
+        for (int i = 0; i < a.size(); i++)
+            if (a[i].type != b[i].type || a[i].path != b[i].path) return false;
+        return true;
+    }
 
-                glm::vec3 Vnew = Vn + Vt;
+    // connectivity of one cloth from its triangles: sorting the triangle sides makes the two sides of an
+    // interior edge neighbours
+    void sortCloth(ClothRange& cloth)
+    {
+        const vector<unsigned int>& indices = meshes[0].indices;
+        triple.clear();
+        for (int t = cloth.firstTriangle; t < cloth.firstTriangle + cloth.triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+            {
+                int a = indices[3 * t + k], b = indices[3 * t + (k + 1) % 3];
+                Triple side = { min(a, b), max(a, b), t };
+                triple.push_back(side);
+            }
+        sort(triple.begin(), triple.end(), cmp);
 
-                if (distance < 0.775f && distance > 0.725f)
-                {
-                    meshes[i].vertices[j].velocity = Vnew;
-                    isRotating = true;
-                    meshes[i].vertices[j].Position += 0.005f * normal;
-                }
-                else if(distance <= 0.725f && distance>0.7f)
-                {
-                    meshes[i].vertices[j].velocity = Vnew;
-                    isRotating = true;
-                    meshes[i].vertices[j].Position += 0.005f * normal;
-                }
+        auto opposite = [&](int t, int a, int b)
+        {
+            for (int k = 0; k < 3; k++)
+                if (indices[3 * t + k] != a && indices[3 * t + k] != b) return (int)indices[3 * t + k];
+            return a;
+        };
+        cloth.firstEdge = edge.size();
+        cloth.firstDiagonal = diagonal.size();
+        for (int i = 0; i < triple.size(); )
+        {
+            const Triple& side = triple[i];
+            Edge e = { side.firstVertex, side.secondVertex };
+            edge.push_back(e);
+            // a side shared by more than two triangles pairs up the first two
+            int j = i + 1;
+            if (j < triple.size() && triple[j].firstVertex == side.firstVertex && triple[j].secondVertex == side.secondVertex)
+            {
+                Neighbour n = { side.faceIndex, triple[j].faceIndex };
+                Edge d = { opposite(n.firstTriangle, e.firstVertex, e.secondVertex), opposite(n.secondTriangle, e.firstVertex, e.secondVertex) };
+                nei.push_back(n);
+                diagonal.push_back(d);
             }
+            while (j < triple.size() && triple[j].firstVertex == side.firstVertex && triple[j].secondVertex == side.secondVertex)
+                j++;
+            i = j;
         }
-
+        cloth.edgeCount = edge.size() - cloth.firstEdge;
+        cloth.diagonalCount = diagonal.size() - cloth.firstDiagonal;
     }
 
-    void SimulateFriction(glm::vec3 center,float radian) 
+    void createSprings(int c)
     {
-        for (int i = 0; i < meshes.size(); i++)
-        {
-            for (int j = 0; j < meshes[i].vertices.size(); j++) 
-            {
-                float distance = glm::length(meshes[i].vertices[j].Position - center);
-                if (isRotating)
-                {
-                    glm::vec3 pressure = meshes[i].vertices[j].Position - center;
-                    glm::vec3 pressureMagnitude = pressure / glm::length(pressure);
-
-                    float coseta = glm::dot(pressureMagnitude, glm::vec3(0, -1, 0));
-                    glm::vec3 target = gravity * coseta;
-
-                    float maxStaticFriction = staticU * glm::length(target);
-
-                    glm::vec3 temp_tagent = glm::cross(meshes[i].vertices[j].Position - center, gravity);
-
-                    glm::vec3 tangent = temp_tagent / glm::length(temp_tagent);
-
-                    float currentFriction = 1 * ballacc;
-                    if (currentFriction > maxStaticFriction)
-                    {
-                        if (distance <7.5f)
-                        {
-                            float dynamicFiction = dynamicU * glm::length(target);
-                            meshes[i].vertices[j].velocity += dynamicFiction * tangent * 7.5f;
+        ClothRange& cloth = cloths[c];
+        vector<Vertex>& pool = meshes[0].vertices;
+        cloth.firstSpring = springs.size();
+        //Structural
+        for (int j = cloth.firstEdge; j < cloth.firstEdge + cloth.edgeCount; j++)
+            springs.push_back(Spring(&pool[edge[j].firstVertex], &pool[edge[j].secondVertex], structuralCoef, dampCoef));
+        //Blending
+        for (int j = cloth.firstDiagonal; j < cloth.firstDiagonal + cloth.diagonalCount; j++)
+            springs.push_back(Spring(&pool[diagonal[j].firstVertex], &pool[diagonal[j].secondVertex], bendingCoef, dampCoef));
+        cloth.springCount = springs.size() - cloth.firstSpring;
+    }
 
-                        }
-                      
-                    }
+    // after an edit of the pool, source naming for every particle the one it was before or -1 for an added
+    // one: survivors keep their original index, added particles get new ones after every index in use
+    void followParticles(const vector<int>& source)
+    {
+        int n = source.size();
+        int next = 0;
+        for (int p = 0; p < n; p++)
+            if (source[p] >= 0) next = max(next, OriginalParticle(source[p]) + 1);
+        vector<int> order(n);
+        for (int p = 0; p < n; p++)
+            order[p] = source[p] >= 0 ? OriginalParticle(source[p]) : next++;
+        particleOrder.swap(order);
+        particleSlot.assign(next, -1);
+        for (int p = 0; p < n; p++)
+            particleSlot[particleOrder[p]] = p;
+    }
 
-                }
-                    
-            }
-        }
+    // remeshing and tearing work on a single cloth, which afterwards spans the whole pool again
+    void spanPool()
+    {
+        ClothRange& cloth = cloths[0];
+        cloth.particleCount = meshes[0].vertices.size();
+        cloth.triangleCount = meshes[0].indices.size() / 3;
+        cloth.edgeCount = edge.size();
+        cloth.diagonalCount = diagonal.size();
+        cloth.springCount = springs.size();
     }
 
-    void SimulateCorners(int firstIndex, int secondIndex) 
+    // rest positions of the particles when remeshing or tearing created some of them away from rest
+    const vector<glm::vec3>* restPositions() const
     {
-        for (int i = 0; i < meshes.size(); i++)
-        {
-            for (int j = 0; j < meshes[i].vertices.size(); j++) 
-            {
-                meshes[i].vertices[firstIndex].isFixed = true;
-                meshes[i].vertices[secondIndex].isFixed = true;
-            }
-        }
+        if (remeshing) return &remesher.RestPositions();
+        if (tearable) return &tearing.RestPositions();
+        return NULL;
     }
 
-private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const& path)
     {
@@ -626,7 +921,6 @@ private:
                 vector.y = mesh->mNormals[i].y;
                 vector.z = mesh->mNormals[i].z;
                 vertex.Normal = vector;
-                index_Normal.push_back(i);
             }
             // texture coordinates
             if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
@@ -637,7 +931,6 @@ private:
                 vec.x = mesh->mTextureCoords[0][i].x;
                 vec.y = mesh->mTextureCoords[0][i].y;
                 vertex.TexCoords = vec;
-                index_Tex.push_back(i);
                 // tangent
                 vector.x = mesh->mTangents[i].x;
                 vector.y = mesh->mTangents[i].y;
@@ -690,68 +983,15 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if (!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            // only named here, the renderer loads it relative to directory
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
         return textures;
     }
 };
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
 #endif
\ No newline at end of file